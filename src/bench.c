@@ -0,0 +1,698 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../thirdparty/md5.c"
+#include "common.h"
+#include "day01.h"
+#include "day02.h"
+#include "day04.h"
+#include "day05.h"
+#include "day06.h"
+#include "day08.h"
+#include "day12.h"
+#include "input.h"
+#include "input_stream.h"
+#include "md5_stream.h"
+#include "pool.h"
+
+// ==== Harness ====
+
+double bench_now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Print elapsed time and throughput of items processed in that time.
+void bench_report(const char *name, double seconds, double items,
+                  const char *unit) {
+  printf("%-40s %10.2f ms %12.2f M%s/s\n", name, seconds * 1e3,
+         items / seconds / 1e6, unit);
+}
+
+// Keep the optimizer from discarding computed results.
+volatile uint64_t bench_sink;
+
+// Tiny xorshift, so the benchmarks don't depend on rand() quality.
+static inline uint64_t bench_rand(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+// ==== Pool allocator ====
+
+#define BENCH_POOL_LIVE 4096
+#define BENCH_POOL_OPS (20 * 1000 * 1000)
+
+typedef struct {
+  uint64_t a, b, c;
+} bench_node;
+
+// Keep a fixed set of live nodes, replacing a random one on each step.
+void bench_pool_churn(void) {
+  bench_node *live[BENCH_POOL_LIVE];
+  uint64_t rng = 42;
+
+  double start = bench_now();
+  for (usize i = 0; i < BENCH_POOL_LIVE; ++i)
+    live[i] = malloc(sizeof(bench_node));
+  for (usize i = 0; i < BENCH_POOL_OPS; ++i) {
+    usize k = bench_rand(&rng) % BENCH_POOL_LIVE;
+    free(live[k]);
+    live[k] = malloc(sizeof(bench_node));
+    live[k]->a = i;
+  }
+  for (usize i = 0; i < BENCH_POOL_LIVE; ++i) {
+    bench_sink += live[i]->a;
+    free(live[i]);
+  }
+  bench_report("pool churn: malloc", bench_now() - start, BENCH_POOL_OPS,
+               "ops");
+
+  rng = 42;
+  start = bench_now();
+  Pool pool = pool_create_typed(bench_node, 1024);
+  for (usize i = 0; i < BENCH_POOL_LIVE; ++i)
+    live[i] = pool_alloc(&pool);
+  for (usize i = 0; i < BENCH_POOL_OPS; ++i) {
+    usize k = bench_rand(&rng) % BENCH_POOL_LIVE;
+    pool_free(&pool, live[k]);
+    live[k] = pool_alloc(&pool);
+    live[k]->a = i;
+  }
+  for (usize i = 0; i < BENCH_POOL_LIVE; ++i)
+    bench_sink += live[i]->a;
+  pool_destroy(&pool);
+  bench_report("pool churn: pool", bench_now() - start, BENCH_POOL_OPS, "ops");
+}
+
+// Allocate a large batch of nodes, then release all of them, repeatedly.
+void bench_pool_batch(void) {
+  const usize batch = 100 * 1000;
+  const usize rounds = 100;
+  bench_node **nodes = malloc(batch * sizeof(bench_node *));
+
+  double start = bench_now();
+  for (usize r = 0; r < rounds; ++r) {
+    for (usize i = 0; i < batch; ++i)
+      nodes[i] = malloc(sizeof(bench_node));
+    for (usize i = 0; i < batch; ++i)
+      free(nodes[i]);
+  }
+  bench_report("pool batch: malloc", bench_now() - start, batch * rounds,
+               "ops");
+
+  start = bench_now();
+  Pool pool = pool_create_typed(bench_node, 4096);
+  for (usize r = 0; r < rounds; ++r) {
+    for (usize i = 0; i < batch; ++i)
+      nodes[i] = pool_alloc(&pool);
+    for (usize i = 0; i < batch; ++i)
+      pool_free(&pool, nodes[i]);
+  }
+  pool_destroy(&pool);
+  bench_report("pool batch: pool", bench_now() - start, batch * rounds, "ops");
+
+  free(nodes);
+}
+
+// ==== Day 2 pipeline ====
+
+#define BENCH_DAY2_LINES (5 * 1000 * 1000)
+
+// Parse and solve a large generated day 2 input, sequentially and with
+// parsing on a reader thread.
+void bench_day2_pipeline(void) {
+  FILE *f = tmpfile();
+  uint64_t rng = 42;
+  for (usize i = 0; i < BENCH_DAY2_LINES; ++i) {
+    fprintf(f, "%dx%dx%d\n", (int)(bench_rand(&rng) % 30 + 1),
+            (int)(bench_rand(&rng) % 30 + 1), (int)(bench_rand(&rng) % 30 + 1));
+  }
+
+  rewind(f);
+  double start = bench_now();
+  bench_sink += d2_solve(f, PART1);
+  bench_report("day2: sequential", bench_now() - start, BENCH_DAY2_LINES,
+               "lines");
+
+  rewind(f);
+  start = bench_now();
+  bench_sink += d2_solve_pipelined(f, PART1);
+  bench_report("day2: pipelined", bench_now() - start, BENCH_DAY2_LINES,
+               "lines");
+  fclose(f);
+}
+
+// ==== Parsing ====
+
+#define BENCH_PARSE_LINES (2 * 1000 * 1000)
+
+// Parse pre-generated lines with sscanf and with the hand-rolled parsers.
+void bench_parse(void) {
+  static const char *cmds[] = {"turn on", "turn off", "toggle"};
+  char(*d2_lines)[32] = malloc(BENCH_PARSE_LINES * sizeof(*d2_lines));
+  char(*d6_lines)[64] = malloc(BENCH_PARSE_LINES * sizeof(*d6_lines));
+  uint64_t rng = 42;
+  for (usize i = 0; i < BENCH_PARSE_LINES; ++i) {
+    sprintf(d2_lines[i], "%dx%dx%d", (int)(bench_rand(&rng) % 30 + 1),
+            (int)(bench_rand(&rng) % 30 + 1), (int)(bench_rand(&rng) % 30 + 1));
+    int x = bench_rand(&rng) % 500, y = bench_rand(&rng) % 500;
+    sprintf(d6_lines[i], "%s %d,%d through %d,%d",
+            cmds[bench_rand(&rng) % 3], x, y, x + 499, y + 499);
+  }
+
+  double start = bench_now();
+  for (usize i = 0; i < BENCH_PARSE_LINES; ++i) {
+    vec3 v;
+    sscanf(d2_lines[i], "%dx%dx%d", &v.x, &v.y, &v.z);
+    bench_sink += v.x + v.y + v.z;
+  }
+  bench_report("parse day2: sscanf", bench_now() - start, BENCH_PARSE_LINES,
+               "lines");
+
+  start = bench_now();
+  for (usize i = 0; i < BENCH_PARSE_LINES; ++i) {
+    vec3 v;
+    d2_parse_box(d2_lines[i], &v);
+    bench_sink += v.x + v.y + v.z;
+  }
+  bench_report("parse day2: parsers", bench_now() - start, BENCH_PARSE_LINES,
+               "lines");
+
+  start = bench_now();
+  for (usize i = 0; i < BENCH_PARSE_LINES; ++i) {
+    char cmd[32];
+    uint16_t x1, y1, x2, y2;
+    sscanf(d6_lines[i], "%16[a-z ] %hd,%hd through %hd,%hd", cmd, &x1, &y1,
+           &x2, &y2);
+    bench_sink += parse_cmd(cmd) + x1 + y1 + x2 + y2;
+  }
+  bench_report("parse day6: sscanf", bench_now() - start, BENCH_PARSE_LINES,
+               "lines");
+
+  start = bench_now();
+  for (usize i = 0; i < BENCH_PARSE_LINES; ++i) {
+    d6_cmd cmd;
+    day06_parse_line(d6_lines[i], &cmd);
+    bench_sink += cmd.op + cmd.x1 + cmd.y1 + cmd.x2 + cmd.y2;
+  }
+  bench_report("parse day6: parsers", bench_now() - start, BENCH_PARSE_LINES,
+               "lines");
+
+  free(d2_lines);
+  free(d6_lines);
+}
+
+// ==== Splitter ====
+
+#define BENCH_SPLIT_BYTES (64 * 1024 * 1024)
+
+// Tokenize a large buffer of words by copying and by views.
+void bench_split(void) {
+  char *buf = malloc(BENCH_SPLIT_BYTES + 1);
+  uint64_t rng = 42;
+  for (usize i = 0; i < BENCH_SPLIT_BYTES; ++i) {
+    usize r = bench_rand(&rng) % 8;
+    buf[i] = r == 0 ? ' ' : (r == 1 ? ',' : 'a' + r);
+  }
+  buf[BENCH_SPLIT_BYTES] = '\0';
+
+  double start = bench_now();
+  splitter s = splitter_new(buf, " ,");
+  char token[256];
+  usize total = 0;
+  while (splitter_next(&s, sizeof(token), token)) {
+    total += token[0];
+  }
+  bench_sink += total;
+  bench_report("split: copy", bench_now() - start, BENCH_SPLIT_BYTES, "B");
+
+  start = bench_now();
+  s = splitter_new(buf, " ,");
+  strview v;
+  total = 0;
+  while (splitter_next_view(&s, &v)) {
+    total += v.ptr[0];
+  }
+  bench_sink += total;
+  bench_report("split: view", bench_now() - start, BENCH_SPLIT_BYTES, "B");
+  free(buf);
+}
+
+// ==== Line splitting ====
+
+#define BENCH_LINES_BYTES (512 * 1024 * 1024)
+
+// Split a large buffer of short random-length lines, with memchr and with the
+// newline indexer.
+void bench_lines(void) {
+  char *buf = malloc(BENCH_LINES_BYTES + 1);
+  uint64_t rng = 42;
+  for (usize i = 0; i < BENCH_LINES_BYTES;) {
+    usize len = min(bench_rand(&rng) % 60 + 10, BENCH_LINES_BYTES - i);
+    memset(buf + i, 'x', len - 1);
+    buf[i + len - 1] = '\n';
+    i += len;
+  }
+  buf[BENCH_LINES_BYTES] = '\0';
+
+  double start = bench_now();
+  usize total = 0;
+  for (const char *p = buf, *end = buf + BENCH_LINES_BYTES; p < end;) {
+    const char *nl = memchr(p, '\n', end - p);
+    nl = nl ? nl : end;
+    total += nl - p;
+    p = nl + 1;
+  }
+  bench_sink += total;
+  bench_report("lines: memchr", bench_now() - start, BENCH_LINES_BYTES, "B");
+
+  start = bench_now();
+  total = 0;
+  line_iter it = line_iter_create(buf, BENCH_LINES_BYTES);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    total += line.len;
+  }
+  bench_sink += total;
+  bench_report("lines: line_iter", bench_now() - start, BENCH_LINES_BYTES,
+               "B");
+  free(buf);
+}
+
+// ==== Input sources ====
+
+#define BENCH_INPUT_BYTES (256 * 1024 * 1024)
+
+// Count line bytes of a generated file read whole, mapped and streamed.
+void bench_input(void) {
+  const char *path = "build/bench_input.txt";
+  FILE *f = fopen(path, "wb");
+  char line[64];
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\n';
+  for (usize i = 0; i < BENCH_INPUT_BYTES; i += sizeof(line)) {
+    fwrite(line, 1, sizeof(line), f);
+  }
+  fclose(f);
+
+  static const char *names[] = {"input: read", "input: mmap",
+                                "input: stream", "input: stream thread"};
+  for (input_mode mode = INPUT_READ; mode <= INPUT_STREAM_THREAD; ++mode) {
+    double start = bench_now();
+    input_source src;
+    if (!input_open(&src, path, mode))
+      break;
+    usize total = 0;
+    input_buf chunk;
+    while (input_next(&src, &chunk)) {
+      line_iter it = line_iter_create(chunk.data, chunk.len);
+      strview l;
+      while (line_iter_next(&it, &l)) {
+        total += l.len;
+      }
+    }
+    input_close(&src);
+    bench_sink += total;
+    bench_report(names[mode], bench_now() - start, BENCH_INPUT_BYTES, "B");
+  }
+  remove(path);
+}
+
+// ==== MD5 streams ====
+
+#define BENCH_MD5_BYTES (256 * 1024 * 1024)
+
+// MD5 of a 256 MB buffer and of a file with the same contents: md5Update and
+// md5File (byte-wise staging, 1 KB reads) against md5_stream.h.
+void bench_md5_stream(void) {
+  u8 *buf = malloc(BENCH_MD5_BYTES);
+  assert(buf);
+  uint64_t rng = 42;
+  for (usize i = 0; i < BENCH_MD5_BYTES; i += 8) {
+    uint64_t x = bench_rand(&rng);
+    memcpy(buf + i, &x, 8);
+  }
+  const char *path = "build/bench_md5.bin";
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    perror("couldn't write benchmark file");
+    free(buf);
+    return;
+  }
+  fwrite(buf, 1, BENCH_MD5_BYTES, f);
+  fclose(f);
+
+  u8 digest[16];
+  double start = bench_now();
+  MD5Context ctx;
+  md5Init(&ctx);
+  md5Update(&ctx, buf, BENCH_MD5_BYTES);
+  md5Finalize(&ctx);
+  bench_sink += ctx.digest[0];
+  bench_report("md5: md5Update", bench_now() - start, BENCH_MD5_BYTES, "B");
+
+  start = bench_now();
+  md5_buffer(buf, BENCH_MD5_BYTES, digest);
+  bench_sink += digest[0];
+  bench_report("md5: md5_buffer", bench_now() - start, BENCH_MD5_BYTES, "B");
+
+  start = bench_now();
+  f = fopen(path, "rb");
+  md5File(f, digest);
+  fclose(f);
+  bench_sink += digest[0];
+  bench_report("md5: md5File", bench_now() - start, BENCH_MD5_BYTES, "B");
+
+  start = bench_now();
+  md5_path(path, digest);
+  bench_sink += digest[0];
+  bench_report("md5: md5_path (mmap)", bench_now() - start, BENCH_MD5_BYTES,
+               "B");
+
+  start = bench_now();
+  f = fopen(path, "rb");
+  md5_stream_file(f, digest);
+  fclose(f);
+  bench_sink += digest[0];
+  bench_report("md5: md5_stream_file", bench_now() - start, BENCH_MD5_BYTES,
+               "B");
+  remove(path);
+  free(buf);
+}
+
+// ==== Day 1 ====
+
+#define BENCH_PARENS_BYTES (1024 * 1024 * 1024)
+
+// Floor and first basement of a 1 GB paren stream reaching the basement only at
+// its very end, against a byte-at-a-time loop.
+void bench_day1(void) {
+  char *buf = malloc(BENCH_PARENS_BYTES);
+  assert(buf);
+  const usize n = BENCH_PARENS_BYTES;
+  uint64_t rng = 42;
+  for (usize i = 0; i < n; i += 2) {
+    bool flip = bench_rand(&rng) & 1;
+    buf[i] = flip ? ')' : '(';
+    buf[i + 1] = flip ? '(' : ')';
+  }
+  buf[0] = '(';
+  buf[1] = '(';
+  buf[n - 2] = ')';
+  buf[n - 1] = ')';
+
+  double start = bench_now();
+  i64 floor = 0;
+  usize basement = 0;
+  for (usize i = 0; i < n; ++i) {
+    floor += (buf[i] == '(') - (buf[i] == ')');
+    if (floor < 0 && basement == 0)
+      basement = i + 1;
+  }
+  bench_sink += floor + basement;
+  bench_report("day1: scalar", bench_now() - start, n, "B");
+
+  start = bench_now();
+  bench_sink += d1_floor(buf, n);
+  bench_report("day1: floor", bench_now() - start, n, "B");
+
+  start = bench_now();
+  bench_sink += d1_first_basement(buf, n);
+  bench_report("day1: first basement", bench_now() - start, n, "B");
+  free(buf);
+}
+
+// ==== Day 4 ====
+
+// Day 4 part 1 search, one md5String per candidate against MD5_LANES at once.
+void bench_day4(void) {
+  double start = bench_now();
+  uint32_t n = 0;
+  for (;; ++n) {
+    char s[32];
+    u8 digest[16];
+    sprintf(s, "%s%u", INPUT, n);
+    md5String(s, digest);
+    if (digest[0] == 0 && digest[1] == 0 && digest[2] < 0x10)
+      break;
+  }
+  bench_sink += n;
+  bench_report("day4: md5String", bench_now() - start, n, "H");
+
+  start = bench_now();
+  n = pow_search(INPUT, 5, 0, 1);
+  bench_sink += n;
+  bench_report("day4: lanes", bench_now() - start, n, "H");
+
+  // part 2, where there is enough work to spread
+  start = bench_now();
+  n = pow_search(INPUT, 6, 0, 1);
+  bench_report("day4: six zeroes, 1 thread", bench_now() - start, n, "H");
+  start = bench_now();
+  n = pow_search(INPUT, 6, 0, cpu_count());
+  bench_report("day4: six zeroes, all threads", bench_now() - start, n, "H");
+  bench_sink += n;
+}
+
+// ==== Day 5 ====
+
+#define BENCH_NICE_LINES (8 * 1024 * 1024)
+
+// Classify 16-letter lines with is_nice one by one, and in batch.
+void bench_day5(void) {
+  const usize len = BENCH_NICE_LINES * 17;
+  char *buf = malloc(len + 1);
+  assert(buf);
+  uint64_t rng = 42;
+  for (usize i = 0; i < len; ++i) {
+    buf[i] = i % 17 == 16 ? '\n' : 'a' + bench_rand(&rng) % 26;
+  }
+  buf[len] = '\0';
+
+  double start = bench_now();
+  usize count = 0;
+  for (usize i = 0; i < len; i += 17) {
+    count += is_nice(buf + i);
+  }
+  bench_sink += count;
+  bench_report("day5: is_nice", bench_now() - start, BENCH_NICE_LINES,
+               "lines");
+
+  start = bench_now();
+  bench_sink += d5_count_nice(buf, len);
+  bench_report("day5: batch", bench_now() - start, BENCH_NICE_LINES, "lines");
+  free(buf);
+}
+
+// ==== Day 6 ====
+
+#define BENCH_DAY6_CMDS 300
+
+// Random commands like the puzzle's, over a size x size grid.
+d6_cmd *bench_day6_cmds(u32 size) {
+  d6_cmd *cmds = malloc(BENCH_DAY6_CMDS * sizeof(d6_cmd));
+  assert(cmds);
+  uint64_t rng = 42;
+  for (usize i = 0; i < BENCH_DAY6_CMDS; ++i) {
+    u32 x1 = bench_rand(&rng) % size, y1 = bench_rand(&rng) % size;
+    cmds[i] = (d6_cmd){.op = (bs_range_op[]){SET, CLEAR, FLIP}[i % 3],
+                       .x1 = x1,
+                       .y1 = y1,
+                       .x2 = x1 + bench_rand(&rng) % (size - x1),
+                       .y2 = y1 + bench_rand(&rng) % (size - y1)};
+  }
+  return cmds;
+}
+
+// 300 commands on the 1000x1000 grid, cell by cell, bit-packed (part 1) and
+// compressed, on an 8192x8192 grid in row bands, and compressed on a
+// 10^6 x 10^6 grid.
+void bench_day6(void) {
+  d6_cmd *cmds = bench_day6_cmds(D6_GRID_SIZE);
+  for (solution_part part = PART1; part <= PART2; ++part) {
+    double start = bench_now();
+    grid g = day06_grid_create(part);
+    for (usize i = 0; i < BENCH_DAY6_CMDS; ++i) {
+      day06_apply(&g, part, cmds[i]);
+    }
+    bench_sink += day06_total(&g);
+    grid_free(&g);
+    bench_report(part == PART1 ? "day6: grid, part 1" : "day6: grid, part 2",
+                 bench_now() - start, BENCH_DAY6_CMDS, "cmds");
+
+    if (part == PART1) {
+      start = bench_now();
+      d6_bitgrid bits = d6_bitgrid_create(D6_GRID_SIZE, D6_GRID_SIZE);
+      for (usize i = 0; i < BENCH_DAY6_CMDS; ++i) {
+        d6_bitgrid_apply(&bits, cmds[i]);
+      }
+      bench_sink += d6_bitgrid_count(&bits);
+      d6_bitgrid_free(&bits);
+      bench_report("day6: bits, part 1", bench_now() - start, BENCH_DAY6_CMDS,
+                   "cmds");
+    }
+
+    start = bench_now();
+    bench_sink += day06_compressed_total(cmds, BENCH_DAY6_CMDS, part);
+    bench_report(part == PART1 ? "day6: compressed, part 1"
+                               : "day6: compressed, part 2",
+                 bench_now() - start, BENCH_DAY6_CMDS, "cmds");
+  }
+  free(cmds);
+
+  // a grid big enough to spread over threads
+  const u32 big = 8192;
+  cmds = bench_day6_cmds(big);
+  double cells = 0; // lights touched
+  for (usize i = 0; i < BENCH_DAY6_CMDS; ++i) {
+    cells += (double)(cmds[i].x2 - cmds[i].x1 + 1) *
+             (cmds[i].y2 - cmds[i].y1 + 1);
+  }
+  for (solution_part part = PART1; part <= PART2; ++part) {
+    usize threads[] = {1, cpu_count()};
+    for (int t = 0; t < 2; ++t) {
+      grid g = day06_grid_create_sized(part, big, big);
+      double start = bench_now();
+      bench_sink += day06_apply_banded(&g, part, cmds, BENCH_DAY6_CMDS,
+                                       threads[t]);
+      char name[64];
+      snprintf(name, sizeof(name), "day6: 8192^2 bands, part %d, %zu threads",
+               part + 1, threads[t]);
+      bench_report(name, bench_now() - start, cells, "cells");
+      grid_free(&g);
+    }
+  }
+  free(cmds);
+
+  cmds = bench_day6_cmds(1000 * 1000);
+  double start = bench_now();
+  bench_sink += day06_compressed_total(cmds, BENCH_DAY6_CMDS, PART2);
+  bench_report("day6: compressed, 10^6 grid", bench_now() - start,
+               BENCH_DAY6_CMDS, "cmds");
+  free(cmds);
+}
+
+// ==== Day 8 ====
+
+#define BENCH_ESCAPES_BYTES (256 * 1024 * 1024)
+
+// Escape counts over generated string literals, line by line and whole buffer.
+void bench_day8(void) {
+  static const char *pieces[] = {"abc", "\\\\", "\\\"", "\\x27", "zz"};
+  char *buf = malloc(BENCH_ESCAPES_BYTES + 64);
+  assert(buf);
+  uint64_t rng = 42;
+  usize len = 0;
+  while (len < BENCH_ESCAPES_BYTES) {
+    buf[len++] = '"';
+    for (int k = bench_rand(&rng) % 12; k >= 0; --k) {
+      const char *piece = pieces[bench_rand(&rng) % 5];
+      memcpy(buf + len, piece, strlen(piece));
+      len += strlen(piece);
+    }
+    buf[len++] = '"';
+    buf[len++] = '\n';
+  }
+  buf[len] = '\0';
+
+  double start = bench_now();
+  d8_totals totals = {0};
+  line_iter it = line_iter_create(buf, len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    d8_result r = d8_process_line(line.ptr);
+    totals.code_count += r.code_count;
+    totals.char_count += r.char_count;
+  }
+  bench_sink += totals.code_count - totals.char_count;
+  bench_report("day8: per line", bench_now() - start, len, "B");
+
+  for (usize i = 0; i < len; ++i) {
+    buf[i] = buf[i] == '\0' ? '\n' : buf[i]; // undo line_iter
+  }
+  start = bench_now();
+  totals = (d8_totals){0};
+  d8_scan(buf, len, &totals);
+  bench_sink += totals.code_count - totals.char_count;
+  bench_report("day8: whole buffer", bench_now() - start, len, "B");
+  free(buf);
+}
+
+// ==== Day 12 ====
+
+#define BENCH_JSON_BYTES (2ULL * 1024 * 1024 * 1024)
+
+// Sum numbers of a generated multi-GB json document, all of them and skipping
+// red objects.
+void bench_day12(void) {
+  const char *path = "build/bench_day12.json";
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    perror("couldn't create benchmark input");
+    return;
+  }
+  const char *item = "{\"a\":[1,2,-3,{\"b\":\"red\",\"c\":[40,50]}],"
+                     "\"d\":{\"e\":\"blue\",\"f\":-678},\"g\":9},";
+  const usize item_len = strlen(item);
+  fputc('[', f);
+  usize size = 1;
+  for (; size + item_len < BENCH_JSON_BYTES; size += item_len) {
+    fwrite(item, 1, item_len, f);
+  }
+  fputs("0]", f);
+  size += 2;
+  fclose(f);
+
+  double start = bench_now();
+  input_buf in = input_map(path);
+  bench_sink += d12_sum_all(in.data);
+  bench_report("day12: all numbers", bench_now() - start, size, "B");
+  input_free(&in);
+
+  start = bench_now();
+  in = input_map(path);
+  bench_sink += d12_sum_stream(in.data, in.len);
+  bench_report("day12: non-red stream", bench_now() - start, size, "B");
+  input_free(&in);
+  remove(path);
+}
+
+typedef struct {
+  const char *name;
+  void (*fn)(void);
+} bench_entry;
+
+bench_entry BENCH_LIST[] = {
+    {"pool churn", bench_pool_churn},
+    {"pool batch", bench_pool_batch},
+    {"day2 pipeline", bench_day2_pipeline},
+    {"parse", bench_parse},
+    {"split", bench_split},
+    {"lines", bench_lines},
+    {"input", bench_input},
+    {"md5 stream", bench_md5_stream},
+    {"day1 parens", bench_day1},
+    {"day4 md5", bench_day4},
+    {"day5 nice", bench_day5},
+    {"day6 lights", bench_day6},
+    {"day8 escapes", bench_day8},
+    {"day12 json", bench_day12},
+
+    {NULL, NULL}};
+
+// Run all benchmarks, or only those whose name contains the argument.
+int main(const int argc, const char *argv[]) {
+  const char *filter = argc > 1 ? argv[1] : "";
+  for (bench_entry *b = BENCH_LIST; b->name != NULL; ++b) {
+    if (strstr(b->name, filter) != NULL) {
+      b->fn();
+    }
+  }
+  return 0;
+}
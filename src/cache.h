@@ -0,0 +1,172 @@
+/*
+Cache of pre-parsed inputs.
+
+A day's parser turns its input into a compact binary payload (an array of
+structs, a matrix...). With caching enabled, the payload is saved to
+CACHE_DIR under a name made of the day's tag and a hash of the input file's
+contents, and later runs with the same input map the payload instead of
+parsing again. Payloads are raw structs, so a cache is only valid for the
+build that wrote it (CACHE_VERSION guards against format changes).
+
+For examples of usage, see day02.h and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include "input.h"
+#include <assert.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define _cache_mkdir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define _cache_mkdir(path) mkdir((path), 0755)
+#endif
+
+#define CACHE_DIR "build/cache"
+#define CACHE_MAGIC 0x43434f41 // "AOCC"
+#define CACHE_VERSION 2
+
+// Off by default, main turns it on with --cache.
+bool cache_enabled = false;
+
+typedef struct {
+  u32 magic;
+  u32 version;
+  u64 input_hash;
+  u64 payload_len;
+} _cache_header;
+
+typedef struct {
+  const void *data;
+  usize len;
+  input_buf _file; // mapped cache file, or data is malloc'ed if not mapped
+} cache_blob;
+
+// Turn input into a malloc'ed payload, false on parse errors.
+typedef bool (*cache_parse_fn)(input_buf *in, void **payload, usize *len);
+
+// Copy of len bytes of data into a new payload, for cache_parse_fn's.
+void *cache_payload_copy(const void *data, usize len) {
+  void *payload = malloc(max(len, 1));
+  assert(payload);
+  if (len > 0)
+    memcpy(payload, data, len);
+  return payload;
+}
+
+// Hash of the whole input, 8 bytes at a time.
+u64 cache_hash(const void *data, usize len) {
+  const u8 *p = data;
+  u64 h = 14695981039346656037ULL ^ len;
+  usize i = 0;
+  for (; i + 8 <= len; i += 8) {
+    u64 w;
+    memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 29;
+  }
+  for (; i < len; ++i) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+void _cache_path(char *path, usize size, const char *tag, u64 input_hash) {
+  snprintf(path, size, CACHE_DIR "/%s-%016llx.bin", tag,
+           (unsigned long long)input_hash);
+}
+
+// Try to map the payload cached for this input, false if there is none.
+bool _cache_load(const char *tag, u64 input_hash, cache_blob *blob) {
+  char path[256];
+  _cache_path(path, sizeof(path), tag, input_hash);
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return false;
+  fclose(f);
+
+  input_buf file = input_map(path);
+  if (file.data == NULL)
+    return false;
+  const _cache_header *hdr = (const _cache_header *)file.data;
+  if (file.len < sizeof(_cache_header) || hdr->magic != CACHE_MAGIC ||
+      hdr->version != CACHE_VERSION || hdr->input_hash != input_hash ||
+      hdr->payload_len != file.len - sizeof(_cache_header)) {
+    input_free(&file);
+    return false;
+  }
+  *blob = (cache_blob){.data = file.data + sizeof(_cache_header),
+                       .len = hdr->payload_len,
+                       ._file = file};
+  return true;
+}
+
+// Write the payload, through a temporary file so a half-written cache is never
+// picked up.
+void _cache_store(const char *tag, u64 input_hash, const void *payload,
+                  usize len) {
+  _cache_mkdir("build");
+  _cache_mkdir(CACHE_DIR);
+  char path[256], tmp_path[272];
+  _cache_path(path, sizeof(path), tag, input_hash);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (f == NULL) {
+    perror("couldn't write cache");
+    return;
+  }
+  _cache_header hdr = {.magic = CACHE_MAGIC,
+                       .version = CACHE_VERSION,
+                       .input_hash = input_hash,
+                       .payload_len = len};
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+            (len == 0 || fwrite(payload, len, 1, f) == 1);
+  ok = fclose(f) == 0 && ok;
+  remove(path); // rename doesn't replace existing files on windows
+  if (!ok || rename(tmp_path, path) != 0) {
+    perror("couldn't write cache");
+    remove(tmp_path);
+  }
+}
+
+// Get the parsed payload for the input file: from the cache if enabled and
+// present, otherwise by running parse (and then caching the result if
+// enabled). False if the input can't be read or parsed.
+bool cache_get(const char *tag, const char *input_path, cache_parse_fn parse,
+               cache_blob *blob) {
+  input_buf in = input_map(input_path);
+  if (in.data == NULL)
+    return false;
+  u64 h = cache_enabled ? cache_hash(in.data, in.len) : 0;
+  if (cache_enabled && _cache_load(tag, h, blob)) {
+    input_free(&in);
+    return true;
+  }
+
+  void *payload = NULL;
+  usize len = 0;
+  bool ok = parse(&in, &payload, &len);
+  input_free(&in);
+  if (!ok) {
+    free(payload);
+    return false;
+  }
+  if (cache_enabled) {
+    _cache_store(tag, h, payload, len);
+  }
+  *blob = (cache_blob){.data = payload, .len = len, ._file = {0}};
+  return true;
+}
+
+void cache_blob_free(cache_blob *blob) {
+  if (blob->_file.data != NULL) {
+    input_free(&blob->_file);
+  } else {
+    free((void *)blob->data);
+  }
+  blob->data = NULL;
+  blob->len = 0;
+}
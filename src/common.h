@@ -20,6 +20,8 @@
 #ifdef _WIN32
 #define _CRT_SECURE_NO_WARNINGS 1
 #define strdup _strdup
+#else
+#include <unistd.h>
 #endif
 
 #ifndef min
@@ -32,29 +34,184 @@
 
 #define min3(a, b, c) min(a, min(b, c))
 
+#define CACHE_LINE_SIZE 64
+
+// Round n up to a multiple of alignment (which must be a power of 2).
+static inline usize align_up(usize n, usize alignment) {
+  return (n + alignment - 1) & ~(alignment - 1);
+}
+
+// Allocate memory with given alignment (a power of 2), free with
+// free_aligned.
+void *malloc_aligned(usize alignment, usize size) {
+  size = align_up(size, alignment);
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  return aligned_alloc(alignment, size);
+#endif
+}
+
+void free_aligned(void *ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+// Number of online CPUs, at least 1.
+usize cpu_count(void) {
+#ifdef _WIN32
+  const char *n = getenv("NUMBER_OF_PROCESSORS");
+  long count = n ? atol(n) : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return count > 0 ? (usize)count : 1;
+}
+
 typedef enum { PART1, PART2 } solution_part;
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Number of trailing zero bits, x must not be 0.
+static inline u32 ctz64(u64 x) {
+#if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return idx;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+static inline u32 popcount64(u64 x) {
+#if defined(_MSC_VER)
+  return (u32)__popcnt64(x);
+#else
+  return __builtin_popcountll(x);
+#endif
+}
+
+// Non-owning view into a string, not necessarily null-terminated.
+typedef struct {
+  const char *ptr;
+  usize len;
+} strview;
+
+// ==== Parsing ====
+// Small parsers for fixed-format lines, used instead of sscanf in hot loops.
+// Each takes a cursor into the string, and on success advances it past what
+// was parsed. On failure they return false and leave the cursor alone.
+
+// Skip spaces and tabs.
+static inline void skip_ws(const char **s) {
+  while (**s == ' ' || **s == '\t') {
+    ++*s;
+  }
+}
+
+// Parse an unsigned decimal number, false if there are no digits or it
+// overflows.
+static inline bool parse_u32(const char **s, uint32_t *result) {
+  const char *p = *s;
+  uint64_t n = 0;
+  while (*p >= '0' && *p <= '9') {
+    n = n * 10 + (*p - '0');
+    if (n > UINT32_MAX)
+      return false;
+    ++p;
+  }
+  if (p == *s)
+    return false;
+  *result = n;
+  *s = p;
+  return true;
+}
+
+// Match the literal string exactly.
+static inline bool expect_literal(const char **s, const char *lit) {
+  const char *p = *s;
+  for (; *lit != '\0'; ++p, ++lit) {
+    if (*p != *lit)
+      return false;
+  }
+  *s = p;
+  return true;
+}
+
+static inline bool _is_word_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Parse a non-empty run of ASCII letters as a view into the string.
+static inline bool parse_word(const char **s, strview *word) {
+  const char *p = *s;
+  while (_is_word_char(*p)) {
+    ++p;
+  }
+  if (p == *s)
+    return false;
+  *word = (strview){.ptr = *s, .len = p - *s};
+  *s = p;
+  return true;
+}
+
+// Copy the view into buf as a C string, false if it doesn't fit.
+static inline bool strview_copy(strview v, char *buf, usize size) {
+  if (v.len + 1 > size)
+    return false;
+  memcpy(buf, v.ptr, v.len);
+  buf[v.len] = '\0';
+  return true;
+}
+
 typedef struct {
   const char *input;
-  const char *sep;
+  bool is_sep[256]; // separator chars, and '\0' which ends every token
 } splitter;
 
 splitter splitter_new(const char *input, const char *sep) {
-  return (splitter){input, sep};
+  splitter s = {.input = input, .is_sep = {0}};
+  for (const char *c = sep; *c != '\0'; ++c) {
+    s.is_sep[(u8)*c] = true;
+  }
+  s.is_sep[0] = true;
+  return s;
+}
+
+// Get a view of the next token, pointing into the input.
+bool splitter_next_view(splitter *s, strview *token) {
+  const char *p = s->input;
+  if (*p == '\0') {
+    return false;
+  }
+  while (!s->is_sep[(u8)*p]) {
+    ++p;
+  }
+  *token = (strview){.ptr = s->input, .len = p - s->input};
+  while (*p != '\0' && s->is_sep[(u8)*p]) {
+    ++p;
+  }
+  s->input = p;
+  return true;
 }
 
+// Copy the next token into the buffer, false if there are no more tokens or
+// the token doesn't fit.
 bool splitter_next(splitter *s, size_t token_size, char *token) {
-  if (*s->input == '\0') {
+  const char *saved = s->input;
+  strview v;
+  if (!splitter_next_view(s, &v)) {
     return false;
   }
-  size_t len = strcspn(s->input, s->sep);
-  if (len + 1 > token_size) {
+  if (!strview_copy(v, token, token_size)) {
+    s->input = saved;
     return false;
   }
-  memcpy(token, s->input, len);
-  token[len] = '\0';
-  s->input += len;
-  s->input += strspn(s->input, s->sep);
   return true;
 }
 
@@ -9,6 +9,7 @@ For examples of usage, see test.c
 
 #pragma once
 
+#include "arena.h"
 #include "common.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -529,28 +530,691 @@ void _bitset_range_do(const bs_range_op op, bitset **bs, const size_t bit_idx,
   _bitset_range_do(FLIP, &(bs), (bit_idx), (length))
 
 // ==== Strings pool ====
+// (interns strings, handing out stable dense ids 0, 1, 2...)
+// keys are stored in a chain of arenas, lookup goes through a hashtable of
+// (hash, id) buckets that compares the actual strings on hash match
+
+#define STRPOOL_ARENA_SIZE (64 * 1024)
 
 typedef struct {
-  char **arr;
+  char **arr;            // id -> interned string
+  Arena *arenas;         // storage for the strings, last one is current
+  _HTBucketsHeader *ht;  // hash -> id
 } strpool;
 
-strpool strpool_init() { return (strpool){.arr = NULL}; }
+strpool strpool_init() {
+  return (strpool){.arr = NULL, .arenas = NULL, .ht = NULL};
+}
 
-usize strpool_idx(strpool *pool, const char *s) {
-  for (usize i = 0; i < arr_len(pool->arr); i++) {
-    if (strcmp(pool->arr[i], s) == 0) {
-      return i;
+usize strpool_len(const strpool *pool) { return arr_len(pool->arr); }
+
+// Find bucket holding the string, or the empty bucket where it should go.
+ptrdiff_t _strpool_find_bucket(const strpool *pool, const char *s,
+                               uint64_t h) {
+  _HTBucket *buckets = (_HTBucket *)(pool->ht + 1);
+  ptrdiff_t b_idx = _ht_bucket_starting_idx(pool->ht, h);
+  while (buckets[b_idx].idx != -1 &&
+         (buckets[b_idx].hash != h ||
+          strcmp(pool->arr[buckets[b_idx].idx], s) != 0)) {
+    if (++b_idx == pool->ht->cap) {
+      b_idx = 0;
     }
   }
-  arr_push(pool->arr, strdup(s));
-  return arr_len(pool->arr) - 1;
+  return b_idx;
 }
 
-usize strpool_len(const strpool *pool) { return arr_len(pool->arr); }
+// Double the bucket count. Unlike _ht_buckets_grow, doesn't assume distinct
+// strings have distinct hashes.
+void _strpool_grow(strpool *pool) {
+  _HTBucketsHeader *new_ht = _ht_new(pool->ht->cap * DS_GROW_FACTOR);
+  _HTBucket *old_buckets = (_HTBucket *)(pool->ht + 1);
+  _HTBucket *new_buckets = (_HTBucket *)(new_ht + 1);
+  for (size_t i = 0; i < pool->ht->cap; ++i) {
+    if (old_buckets[i].idx == -1)
+      continue;
+    ptrdiff_t b_idx = _ht_bucket_starting_idx(new_ht, old_buckets[i].hash);
+    while (new_buckets[b_idx].idx != -1) {
+      if (++b_idx == new_ht->cap) {
+        b_idx = 0;
+      }
+    }
+    new_buckets[b_idx] = old_buckets[i];
+  }
+  free(pool->ht);
+  pool->ht = new_ht;
+}
+
+// Copy the string into the pool's arenas, starting a new arena if needed.
+char *_strpool_store(strpool *pool, const char *s) {
+  usize n = arr_len(pool->arenas);
+  char *copy = n ? arena_strdup(&pool->arenas[n - 1], s) : NULL;
+  if (copy == NULL) {
+    usize len = strlen(s);
+    arr_push(pool->arenas, arena_create(max(STRPOOL_ARENA_SIZE, len + 1)));
+    copy = arena_strdup(&pool->arenas[n], s);
+  }
+  assert(copy != NULL);
+  return copy;
+}
+
+// Get id of the string, or -1 if it wasn't interned.
+isize strpool_lookup(const strpool *pool, const char *s) {
+  if (pool->ht == NULL) {
+    return -1;
+  }
+  _HTBucket *buckets = (_HTBucket *)(pool->ht + 1);
+  return buckets[_strpool_find_bucket(pool, s, hash_string(s))].idx;
+}
+
+// Get id of the string, interning it if it wasn't seen before.
+usize strpool_idx(strpool *pool, const char *s) {
+  if (pool->ht == NULL) {
+    pool->ht = _ht_new(DS_INITIAL_CAPACITY);
+  }
+  uint64_t h = hash_string(s);
+  _HTBucket *buckets = (_HTBucket *)(pool->ht + 1);
+  ptrdiff_t b_idx = _strpool_find_bucket(pool, s, h);
+  if (buckets[b_idx].idx != -1) {
+    return buckets[b_idx].idx;
+  }
+
+  arr_push(pool->arr, _strpool_store(pool, s));
+  usize id = strpool_len(pool) - 1;
+  buckets[b_idx] = (_HTBucket){.hash = h, .idx = id};
+  if (strpool_len(pool) * 4 > pool->ht->cap * 3) {
+    _strpool_grow(pool);
+  }
+  return id;
+}
+
+// Get the interned string by its id.
+const char *strpool_get(const strpool *pool, usize id) {
+  assert(id < strpool_len(pool));
+  return pool->arr[id];
+}
 
 void strpool_free(strpool *pool) {
-  for (usize i = 0; i < arr_len(pool->arr); ++i) {
-    free(pool->arr[i]);
+  for (usize i = 0; i < arr_len(pool->arenas); ++i) {
+    arena_free(&pool->arenas[i]);
   }
+  arr_free(pool->arenas);
   arr_free(pool->arr);
+  free(pool->ht);
+  pool->ht = NULL;
+}
+
+// ==== 2D Grid ====
+// (fixed size 2d array of elements of any size, zero-initialized)
+// Row-major by default, or tiled: the grid is split into GRID_TILE x GRID_TILE
+// blocks stored one after another, so a rectangle touches fewer pages and cache
+// lines. Either way, elements within a row are contiguous in spans (a whole row,
+// or a tile's worth of row), and the rect helpers work span by span.
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GRID_SSE2 1
+#endif
+
+#define GRID_TILE 64 // elements per tile side, must be power of 2
+#define GRID_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+typedef enum {
+  GRID_ROW_MAJOR = 0,
+  GRID_TILED = 1 << 0,
+  GRID_HUGE_PAGES = 1 << 1, // best effort, only on linux
+} grid_flags;
+
+typedef struct {
+  usize width, height;
+  usize elem_size;
+  usize stride; // elements per stored row (row-major), padded to a cache line
+  usize tiles_per_row; // (tiled)
+  usize size_bytes;    // including padding, all of it zeroed
+  grid_flags flags;
+  u8 *data;
+} grid;
+
+grid grid_create(usize width, usize height, usize elem_size, grid_flags flags) {
+  grid g = {.width = width,
+            .height = height,
+            .elem_size = elem_size,
+            .flags = flags};
+  usize rows;
+  if (flags & GRID_TILED) {
+    g.tiles_per_row = align_up(width, GRID_TILE) / GRID_TILE;
+    g.stride = g.tiles_per_row * GRID_TILE;
+    rows = align_up(height, GRID_TILE);
+  } else {
+    g.stride = CACHE_LINE_SIZE % elem_size == 0
+                   ? align_up(width * elem_size, CACHE_LINE_SIZE) / elem_size
+                   : width;
+    rows = height;
+  }
+  g.size_bytes = g.stride * rows * elem_size;
+
+  usize alignment =
+      (flags & GRID_HUGE_PAGES) ? GRID_HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+  g.size_bytes = align_up(g.size_bytes, alignment);
+  g.data = malloc_aligned(alignment, g.size_bytes);
+  assert(g.data);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (flags & GRID_HUGE_PAGES) {
+    madvise(g.data, g.size_bytes, MADV_HUGEPAGE);
+  }
+#endif
+  memset(g.data, 0, g.size_bytes);
+  return g;
+}
+
+#define grid_create_typed(type, width, height, flags)                          \
+  grid_create((width), (height), sizeof(type), (flags))
+
+void grid_free(grid *g) {
+  free_aligned(g->data);
+  g->data = NULL;
+}
+
+// Offset of the element in elements from the start of data.
+static inline usize _grid_offset(const grid *g, usize x, usize y) {
+  if (g->flags & GRID_TILED) {
+    usize tile = (y / GRID_TILE) * g->tiles_per_row + x / GRID_TILE;
+    return tile * GRID_TILE * GRID_TILE + (y % GRID_TILE) * GRID_TILE +
+           x % GRID_TILE;
+  }
+  return x + y * g->stride;
+}
+
+static inline void *grid_ptr(const grid *g, usize x, usize y) {
+  assert(x < g->width && y < g->height);
+  return g->data + _grid_offset(g, x, y) * g->elem_size;
+}
+
+// Element at (x, y) as an lvalue of the given type.
+#define grid_at(g, type, x, y) (*(type *)grid_ptr((g), (x), (y)))
+
+// Pointer to the contiguous run of elements starting at (x, y), storing its
+// length into len: the rest of the row, or of the tile's row if tiled.
+void *grid_span(const grid *g, usize x, usize y, usize *len) {
+  *len = (g->flags & GRID_TILED) ? GRID_TILE - x % GRID_TILE : g->width - x;
+  *len = min(*len, g->width - x);
+  return grid_ptr(g, x, y);
+}
+
+// Pointer to the start of a row, only for row-major grids.
+void *grid_row(const grid *g, usize y) {
+  assert(!(g->flags & GRID_TILED));
+  return grid_ptr(g, 0, y);
+}
+
+typedef void (*grid_span_fn)(void *span, usize len, const void *ctx);
+typedef u64 (*grid_span_reduce_fn)(const void *span, usize len);
+
+// Call fn on every span of the rectangle (corners inclusive). Tiled grids are
+// walked tile by tile.
+void grid_rect_apply(grid *g, usize x1, usize y1, usize x2, usize y2,
+                     grid_span_fn fn, const void *ctx) {
+  assert(x1 <= x2 && y1 <= y2 && x2 < g->width && y2 < g->height);
+  if (!(g->flags & GRID_TILED)) {
+    for (usize y = y1; y <= y2; ++y) {
+      fn(grid_ptr(g, x1, y), x2 - x1 + 1, ctx);
+    }
+    return;
+  }
+  for (usize ty = y1 / GRID_TILE; ty <= y2 / GRID_TILE; ++ty) {
+    usize row_from = max(y1, ty * GRID_TILE);
+    usize row_to = min(y2, ty * GRID_TILE + GRID_TILE - 1);
+    for (usize tx = x1 / GRID_TILE; tx <= x2 / GRID_TILE; ++tx) {
+      usize col_from = max(x1, tx * GRID_TILE);
+      usize col_to = min(x2, tx * GRID_TILE + GRID_TILE - 1);
+      for (usize y = row_from; y <= row_to; ++y) {
+        fn(grid_ptr(g, col_from, y), col_to - col_from + 1, ctx);
+      }
+    }
+  }
+}
+
+// Sum fn over every span of the rectangle (corners inclusive).
+u64 grid_rect_reduce(const grid *g, usize x1, usize y1, usize x2, usize y2,
+                     grid_span_reduce_fn fn) {
+  assert(x1 <= x2 && y1 <= y2 && x2 < g->width && y2 < g->height);
+  u64 total = 0;
+  for (usize y = y1; y <= y2; ++y) {
+    for (usize x = x1; x <= x2;) {
+      usize len;
+      void *span = grid_span(g, x, y, &len);
+      len = min(len, x2 - x + 1);
+      total += fn(span, len);
+      x += len;
+    }
+  }
+  return total;
+}
+
+// Sum fn over the whole storage in one span, padding included (which is
+// fine as long as nothing writes to the padding, and fn(zeroes) == 0).
+u64 grid_reduce(const grid *g, grid_span_reduce_fn fn) {
+  return fn(g->data, g->size_bytes / g->elem_size);
+}
+
+// ---- u8 span kernels ----
+// ctx points to the u8 operand.
+
+#ifdef GRID_SSE2
+// Apply vec_op to 16 bytes at a time, scalar_op to the tail.
+#define _GRID_U8_KERNEL(span, len, ctx, vec_op, scalar_op)                     \
+  do {                                                                         \
+    u8 *p = (span);                                                            \
+    const u8 v = *(const u8 *)(ctx);                                           \
+    const __m128i vv = _mm_set1_epi8((char)v);                                 \
+    usize i = 0;                                                               \
+    for (; i + 16 <= (len); i += 16) {                                         \
+      __m128i x = _mm_loadu_si128((const __m128i *)(p + i));                   \
+      _mm_storeu_si128((__m128i *)(p + i), vec_op(x, vv));                     \
+    }                                                                          \
+    for (; i < (len); ++i) {                                                   \
+      p[i] = scalar_op(p[i], v);                                               \
+    }                                                                          \
+  } while (0)
+#else
+#define _GRID_U8_KERNEL(span, len, ctx, vec_op, scalar_op)                     \
+  do {                                                                         \
+    u8 *p = (span);                                                            \
+    const u8 v = *(const u8 *)(ctx);                                           \
+    for (usize i = 0; i < (len); ++i) {                                        \
+      p[i] = scalar_op(p[i], v);                                               \
+    }                                                                          \
+  } while (0)
+#endif
+
+#define _grid_u8_xor(a, b) ((a) ^ (b))
+#define _grid_u8_add(a, b) ((u8)((a) + (b)))
+#define _grid_u8_subs(a, b) ((a) > (b) ? (a) - (b) : 0)
+
+void grid_span_u8_fill(void *span, usize len, const void *ctx) {
+  memset(span, *(const u8 *)ctx, len);
+}
+
+void grid_span_u8_xor(void *span, usize len, const void *ctx) {
+  _GRID_U8_KERNEL(span, len, ctx, _mm_xor_si128, _grid_u8_xor);
+}
+
+// Wrapping add.
+void grid_span_u8_add(void *span, usize len, const void *ctx) {
+  _GRID_U8_KERNEL(span, len, ctx, _mm_add_epi8, _grid_u8_add);
+}
+
+// Subtract, saturating at 0.
+void grid_span_u8_sub_sat(void *span, usize len, const void *ctx) {
+  _GRID_U8_KERNEL(span, len, ctx, _mm_subs_epu8, _grid_u8_subs);
+}
+
+u64 grid_span_u8_sum(const void *span, usize len) {
+  const u8 *p = span;
+  u64 total = 0;
+  usize i = 0;
+#ifdef GRID_SSE2
+  // psadbw against zero sums each 8 bytes into a 64-bit lane
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(x, _mm_setzero_si128()));
+  }
+  total = (u64)_mm_cvtsi128_si64(acc) +
+          (u64)_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+#endif
+  for (; i < len; ++i) {
+    total += p[i];
+  }
+  return total;
+}
+
+// ---- u16 span kernels ----
+// ctx points to the u16 operand. Adds saturate instead of wrapping.
+
+#ifdef GRID_SSE2
+// Apply vec_op to 8 elements at a time, scalar_op to the tail.
+#define _GRID_U16_KERNEL(span, len, ctx, vec_op, scalar_op)                    \
+  do {                                                                         \
+    u16 *p = (span);                                                           \
+    const u16 v = *(const u16 *)(ctx);                                         \
+    const __m128i vv = _mm_set1_epi16((short)v);                               \
+    usize i = 0;                                                               \
+    for (; i + 8 <= (len); i += 8) {                                           \
+      __m128i x = _mm_loadu_si128((const __m128i *)(p + i));                   \
+      _mm_storeu_si128((__m128i *)(p + i), vec_op(x, vv));                     \
+    }                                                                          \
+    for (; i < (len); ++i) {                                                   \
+      p[i] = scalar_op(p[i], v);                                               \
+    }                                                                          \
+  } while (0)
+#else
+#define _GRID_U16_KERNEL(span, len, ctx, vec_op, scalar_op)                    \
+  do {                                                                         \
+    u16 *p = (span);                                                           \
+    const u16 v = *(const u16 *)(ctx);                                         \
+    for (usize i = 0; i < (len); ++i) {                                        \
+      p[i] = scalar_op(p[i], v);                                               \
+    }                                                                          \
+  } while (0)
+#endif
+
+#define _grid_u16_adds(a, b) ((a) > UINT16_MAX - (b) ? UINT16_MAX : (a) + (b))
+#define _grid_u16_subs(a, b) ((a) > (b) ? (a) - (b) : 0)
+
+// Add, saturating at UINT16_MAX.
+void grid_span_u16_add_sat(void *span, usize len, const void *ctx) {
+  _GRID_U16_KERNEL(span, len, ctx, _mm_adds_epu16, _grid_u16_adds);
+}
+
+// Subtract, saturating at 0.
+void grid_span_u16_sub_sat(void *span, usize len, const void *ctx) {
+  _GRID_U16_KERNEL(span, len, ctx, _mm_subs_epu16, _grid_u16_subs);
+}
+
+u64 grid_span_u16_sum(const void *span, usize len) {
+  const u16 *p = span;
+  u64 total = 0;
+  usize i = 0;
+#ifdef GRID_SSE2
+  // widen to 32-bit lanes, each gets at most 2 * UINT16_MAX per vector so
+  // they're flushed to the total before they can overflow
+  const usize flush = 8 * 16384;
+  const __m128i zero = _mm_setzero_si128();
+  while (i + 8 <= len) {
+    __m128i acc = zero;
+    usize end = min(len - len % 8, i + flush);
+    for (; i < end; i += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(x, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(x, zero));
+    }
+    __m128i wide = _mm_add_epi64(_mm_unpacklo_epi32(acc, zero),
+                                 _mm_unpackhi_epi32(acc, zero));
+    total += (u64)_mm_cvtsi128_si64(wide) +
+             (u64)_mm_cvtsi128_si64(_mm_unpackhi_epi64(wide, wide));
+  }
+#endif
+  for (; i < len; ++i) {
+    total += p[i];
+  }
+  return total;
+}
+
+// ==== Roaring Bitset ====
+// (compressed set of 64-bit keys, roaring style)
+// The high 48 bits of a key pick a container from a hashtable, the low 16 bits
+// are stored in it. A container is a sorted array of values while small, a
+// 65536-bit bitmap once it gets dense, or a sorted array of runs after
+// roaring_optimize() if that is smaller. Insert only, like the rest of the
+// data structures here.
+
+#define ROARING_ARRAY_MAX 4096 // array containers above this become bitmaps
+#define ROARING_BITMAP_WORDS (65536 / 64)
+#define ROARING_RUN_MAX 2048 // run containers above this become bitmaps
+
+typedef struct {
+  u16 start;
+  u16 len; // number of values after start, so a run covers start..start+len
+} roaring_run;
+
+typedef struct {
+  enum { ROARING_ARRAY, ROARING_BITMAP, ROARING_RUN } type;
+  u32 cardinality;
+  union {
+    u16 *values;       // dynamic array, sorted
+    u64 *bits;         // ROARING_BITMAP_WORDS words
+    roaring_run *runs; // dynamic array, sorted and non-adjacent
+  };
+} roaring_container;
+
+typedef struct {
+  struct {
+    u64 key;
+    roaring_container value;
+  } *containers;
+} roaring;
+
+roaring roaring_create(void) { return (roaring){.containers = NULL}; }
+
+// Index of first element of the sorted u16 array that is >= v.
+usize _roaring_lower_bound(const u16 *values, usize len, u16 v) {
+  usize lo = 0, hi = len;
+  while (lo < hi) {
+    usize mid = (lo + hi) / 2;
+    if (values[mid] < v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Index of the last run starting at or before v, or -1.
+isize _roaring_find_run(const roaring_run *runs, u16 v) {
+  isize lo = 0, hi = arr_len(runs);
+  while (lo < hi) {
+    isize mid = (lo + hi) / 2;
+    if (runs[mid].start <= v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - 1;
+}
+
+static inline bool _roaring_bitmap_has(const u64 *bits, u16 v) {
+  return bits[v >> 6] & (1ULL << (v & 63));
+}
+
+bool _roaring_container_has(const roaring_container *c, u16 v) {
+  switch (c->type) {
+  case ROARING_ARRAY: {
+    usize i = _roaring_lower_bound(c->values, arr_len(c->values), v);
+    return i < arr_len(c->values) && c->values[i] == v;
+  }
+  case ROARING_BITMAP:
+    return _roaring_bitmap_has(c->bits, v);
+  case ROARING_RUN: {
+    isize i = _roaring_find_run(c->runs, v);
+    return i >= 0 && v <= c->runs[i].start + c->runs[i].len;
+  }
+  }
+  return false;
+}
+
+void _roaring_container_free(roaring_container *c) {
+  switch (c->type) {
+  case ROARING_ARRAY:
+    arr_free(c->values);
+    break;
+  case ROARING_BITMAP:
+    free(c->bits);
+    c->bits = NULL;
+    break;
+  case ROARING_RUN:
+    arr_free(c->runs);
+    break;
+  }
+}
+
+// Turn any container into a bitmap container.
+void _roaring_to_bitmap(roaring_container *c) {
+  if (c->type == ROARING_BITMAP)
+    return;
+  u64 *bits = calloc(ROARING_BITMAP_WORDS, sizeof(u64));
+  assert(bits);
+  if (c->type == ROARING_ARRAY) {
+    for (usize i = 0; i < arr_len(c->values); ++i) {
+      bits[c->values[i] >> 6] |= 1ULL << (c->values[i] & 63);
+    }
+  } else {
+    for (usize i = 0; i < arr_len(c->runs); ++i) {
+      for (u32 v = c->runs[i].start; v <= c->runs[i].start + c->runs[i].len;
+           ++v) {
+        bits[v >> 6] |= 1ULL << (v & 63);
+      }
+    }
+  }
+  _roaring_container_free(c);
+  c->type = ROARING_BITMAP;
+  c->bits = bits;
+}
+
+// Insert v (known to be absent) into a run container.
+void _roaring_run_insert(roaring_container *c, u16 v) {
+  isize i = _roaring_find_run(c->runs, v);
+  bool joins_prev = i >= 0 && c->runs[i].start + c->runs[i].len + 1 == v;
+  bool joins_next =
+      i + 1 < (isize)arr_len(c->runs) && c->runs[i + 1].start == v + 1;
+  if (joins_prev && joins_next) {
+    c->runs[i].len += c->runs[i + 1].len + 2;
+    memmove(&c->runs[i + 1], &c->runs[i + 2],
+            (arr_len(c->runs) - i - 2) * sizeof(roaring_run));
+    --_arr_header(c->runs)->len;
+  } else if (joins_prev) {
+    ++c->runs[i].len;
+  } else if (joins_next) {
+    --c->runs[i + 1].start;
+    ++c->runs[i + 1].len;
+  } else {
+    arr_push(c->runs, ((roaring_run){0}));
+    memmove(&c->runs[i + 2], &c->runs[i + 1],
+            (arr_len(c->runs) - i - 2) * sizeof(roaring_run));
+    c->runs[i + 1] = (roaring_run){.start = v, .len = 0};
+    if (arr_len(c->runs) > ROARING_RUN_MAX) {
+      _roaring_to_bitmap(c);
+    }
+  }
+}
+
+// Add the key, returning true if it wasn't in the set yet.
+bool roaring_add(roaring *r, u64 key) {
+  u64 high = key >> 16;
+  u16 low = key & 0xffff;
+  ptrdiff_t idx = ht_get_idx(r->containers, high);
+  if (idx < 0) {
+    roaring_container empty = {.type = ROARING_ARRAY, .values = NULL};
+    ht_put(r->containers, high, empty);
+    idx = ht_size(r->containers) - 1;
+  }
+  roaring_container *c = &r->containers[idx].value;
+
+  switch (c->type) {
+  case ROARING_ARRAY: {
+    usize len = arr_len(c->values);
+    usize i = _roaring_lower_bound(c->values, len, low);
+    if (i < len && c->values[i] == low)
+      return false;
+    if (len == ROARING_ARRAY_MAX) {
+      _roaring_to_bitmap(c);
+      c->bits[low >> 6] |= 1ULL << (low & 63);
+      break;
+    }
+    arr_push(c->values, low);
+    memmove(&c->values[i + 1], &c->values[i], (len - i) * sizeof(u16));
+    c->values[i] = low;
+    break;
+  }
+  case ROARING_BITMAP:
+    if (_roaring_bitmap_has(c->bits, low))
+      return false;
+    c->bits[low >> 6] |= 1ULL << (low & 63);
+    break;
+  case ROARING_RUN:
+    if (_roaring_container_has(c, low))
+      return false;
+    _roaring_run_insert(c, low);
+    break;
+  }
+  ++c->cardinality;
+  return true;
+}
+
+bool roaring_contains(const roaring *r, u64 key) {
+  u64 high = key >> 16;
+  ptrdiff_t idx = ht_get_idx(r->containers, high);
+  return idx >= 0 &&
+         _roaring_container_has(&r->containers[idx].value, key & 0xffff);
+}
+
+// Number of keys in the set.
+u64 roaring_cardinality(const roaring *r) {
+  u64 total = 0;
+  for (usize i = 0; i < ht_size(r->containers); ++i) {
+    total += r->containers[i].value.cardinality;
+  }
+  return total;
+}
+
+usize _roaring_container_bytes(const roaring_container *c) {
+  switch (c->type) {
+  case ROARING_ARRAY:
+    return arr_len(c->values) * sizeof(u16);
+  case ROARING_BITMAP:
+    return ROARING_BITMAP_WORDS * sizeof(u64);
+  case ROARING_RUN:
+    return arr_len(c->runs) * sizeof(roaring_run);
+  }
+  return 0;
+}
+
+// Approximate memory taken by the containers' payload.
+usize roaring_size_bytes(const roaring *r) {
+  usize total = ht_size(r->containers) * sizeof(*r->containers);
+  for (usize i = 0; i < ht_size(r->containers); ++i) {
+    total += _roaring_container_bytes(&r->containers[i].value);
+  }
+  return total;
+}
+
+// Append v to sorted runs, extending the last run if adjacent.
+void _roaring_runs_append(roaring_run **runs, u16 v) {
+  usize n = arr_len(*runs);
+  if (n > 0 && (*runs)[n - 1].start + (*runs)[n - 1].len + 1 == v) {
+    ++(*runs)[n - 1].len;
+  } else {
+    arr_push(*runs, ((roaring_run){.start = v, .len = 0}));
+  }
+}
+
+// Convert each container to runs where that takes less memory.
+void roaring_optimize(roaring *r) {
+  for (usize i = 0; i < ht_size(r->containers); ++i) {
+    roaring_container *c = &r->containers[i].value;
+    if (c->type == ROARING_RUN)
+      continue;
+    roaring_run *runs = NULL;
+    if (c->type == ROARING_ARRAY) {
+      for (usize j = 0; j < arr_len(c->values); ++j) {
+        _roaring_runs_append(&runs, c->values[j]);
+      }
+    } else {
+      for (u32 v = 0; v < 65536 && arr_len(runs) <= ROARING_RUN_MAX; ++v) {
+        if (_roaring_bitmap_has(c->bits, v)) {
+          _roaring_runs_append(&runs, v);
+        }
+      }
+    }
+    if (arr_len(runs) <= ROARING_RUN_MAX &&
+        arr_len(runs) * sizeof(roaring_run) < _roaring_container_bytes(c)) {
+      _roaring_container_free(c);
+      c->type = ROARING_RUN;
+      c->runs = runs;
+    } else {
+      arr_free(runs);
+    }
+  }
+}
+
+void roaring_free(roaring *r) {
+  for (usize i = 0; i < ht_size(r->containers); ++i) {
+    _roaring_container_free(&r->containers[i].value);
+  }
+  ht_free(r->containers);
 }
@@ -1,40 +1,94 @@
 #pragma once
 
 #include "common.h"
+#include "input.h"
 
-size_t day1(const solution_part part) {
-  uint32_t n = 0;
-  FILE *f = fopen("data/input01.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
-    return -1;
+// Floor reached after following all the parens in buf, 64 bytes at a time.
+i64 d1_floor(const char *buf, usize len) {
+  i64 floor = 0;
+  usize i = 0;
+  for (; i + 64 <= len; i += 64) {
+    floor += (i64)popcount64(byte_mask64(buf + i, '(')) -
+             (i64)popcount64(byte_mask64(buf + i, ')'));
   }
-  uint32_t i = 0;
-  while (true) {
-    int c = fgetc(f);
-    if (c == EOF) {
-      break;
-    }
-    switch (c) {
-    case '(':
-      n++;
-      i++;
-      break;
-    case ')':
-      n--;
-      i++;
-      break;
-    default:
-      break;
+  for (; i < len; ++i) {
+    floor += (buf[i] == '(') - (buf[i] == ')');
+  }
+  return floor;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+// Lowest running floor within the 16 bytes at p relative to the floor before
+// them, the change of floor over all of them goes to delta.
+static inline int _d1_scan16(const char *p, int *delta) {
+  __m128i v = _mm_loadu_si128((const __m128i *)p);
+  // '(' -> +1, ')' -> -1, then prefix sum across the lanes
+  __m128i d = _mm_sub_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(')')),
+                           _mm_cmpeq_epi8(v, _mm_set1_epi8('(')));
+  d = _mm_add_epi8(d, _mm_slli_si128(d, 1));
+  d = _mm_add_epi8(d, _mm_slli_si128(d, 2));
+  d = _mm_add_epi8(d, _mm_slli_si128(d, 4));
+  d = _mm_add_epi8(d, _mm_slli_si128(d, 8));
+  *delta = (int8_t)(_mm_extract_epi16(d, 7) >> 8);
+  // horizontal signed min, via unsigned min on biased values
+  __m128i u = _mm_xor_si128(d, _mm_set1_epi8((char)0x80));
+  u = _mm_min_epu8(u, _mm_srli_si128(u, 8));
+  u = _mm_min_epu8(u, _mm_srli_si128(u, 4));
+  u = _mm_min_epu8(u, _mm_srli_si128(u, 2));
+  u = _mm_min_epu8(u, _mm_srli_si128(u, 1));
+  return (int)(u8)_mm_cvtsi128_si32(u) - 128;
+}
+#endif
+
+// Position (1-based) of the paren that first takes us to floor -1, 0 if none.
+// Positions count every byte of buf, other bytes just don't move the floor,
+// as in the puzzle input where the only other byte is a trailing newline.
+// Blocks that can't reach the basement are skipped a block at a time, the
+// matching position is then found in the first block that does.
+usize d1_first_basement(const char *buf, usize len) {
+  i64 floor = 0;
+  usize i = 0;
+  while (i < len) {
+    if (floor >= 64 && i + 64 <= len) {
+      floor += (i64)popcount64(byte_mask64(buf + i, '(')) -
+               (i64)popcount64(byte_mask64(buf + i, ')'));
+      i += 64;
+      continue;
     }
-    if (part == PART2 && n == -1) {
-      fclose(f);
-      return i;
+#if defined(__x86_64__) || defined(_M_X64)
+    int delta;
+    if (i + 16 <= len && floor + _d1_scan16(buf + i, &delta) >= 0) {
+      floor += delta;
+      i += 16;
+      continue;
     }
+#endif
+    break;
+  }
+  for (; i < len; ++i) {
+    floor += (buf[i] == '(') - (buf[i] == ')');
+    if (floor < 0)
+      return i + 1;
+  }
+  return 0;
+}
+
+// Part 1 is the floor, which may be negative. -1 on errors is ambiguous there,
+// but is reported on stderr.
+i64 day1(const solution_part part) {
+  input_buf in = input_map("data/input01.txt");
+  if (in.data == NULL) {
+    return -1;
+  }
+  i64 result;
+  if (part == PART1) {
+    result = d1_floor(in.data, in.len);
+  } else {
+    result = (i64)d1_first_basement(in.data, in.len);
   }
-  fclose(f);
-  return n;
+  input_free(&in);
+  return result;
 }
 
-size_t day1_part1(void) { return day1(PART1); }
-size_t day1_part2(void) { return day1(PART2); }
+i64 day1_part1(void) { return day1(PART1); }
+i64 day1_part2(void) { return day1(PART2); }
@@ -1,13 +1,16 @@
 #pragma once
 
+#include "cache.h"
 #include "common.h"
+#include "data_structures.h"
+#include "input.h"
+#include "pipeline.h"
 #include <stdbool.h>
 #include <stdio.h>
 
 #define NUM_LEN 32
 #define LINE_LEN 128
 
-
 uint32_t day2_formula1(vec3 v) {
   vec3 sv = vec3_sorted(v);
   return 2 * sv.x * sv.y + 2 * sv.x * sv.z + 2 * sv.y * sv.z + sv.x * sv.y;
@@ -18,19 +21,110 @@ uint32_t day2_formula2(vec3 v) {
   return 2 * sv.x + 2 * sv.y + sv.x * sv.y * sv.z;
 }
 
-uint32_t day2(const solution_part part) {
-  FILE *f = fopen("data/input02.txt", "r");
-  uint32_t total = 0;
+// Parse "LxWxH".
+bool d2_parse_box(const char *line, vec3 *vec) {
+  uint32_t x, y, z;
+  if (!parse_u32(&line, &x) || !expect_literal(&line, "x") ||
+      !parse_u32(&line, &y) || !expect_literal(&line, "x") ||
+      !parse_u32(&line, &z)) {
+    return false;
+  }
+  *vec = (vec3){x, y, z};
+  return true;
+}
+
+// Read the next box from the file: 1 if read, 0 at the end of the file, -1 on
+// a parse error.
+int d2_read_box(FILE *f, vec3 *vec) {
   char line[LINE_LEN] = {0};
-  while (fgets(line, LINE_LEN, f) != NULL) {
-    vec3 vec = {0};
-    if (sscanf(line, "%dx%dx%d", &vec.x, &vec.y, &vec.z) != 3) {
-      fprintf(stderr, "error parsing vector: '%s'", line);
-      return -1;
-    }
+  if (fgets(line, LINE_LEN, f) == NULL) {
+    return 0;
+  }
+  if (!d2_parse_box(line, vec)) {
+    fprintf(stderr, "error parsing vector: '%s'", line);
+    return -1;
+  }
+  return 1;
+}
+
+uint32_t d2_solve(FILE *f, const solution_part part) {
+  uint32_t total = 0;
+  vec3 vec;
+  int read;
+  while ((read = d2_read_box(f, &vec)) > 0) {
     total += part == PART1 ? day2_formula1(vec) : day2_formula2(vec);
   }
-  fclose(f);
+  return read < 0 ? (uint32_t)-1 : total;
+}
+
+typedef struct {
+  FILE *f;
+  bool error;
+} d2_reader;
+
+typedef struct {
+  solution_part part;
+  uint32_t total;
+} d2_sum;
+
+// Stops the pipeline on a parse error, with the reader's error set.
+bool _d2_produce(void *ctx, void *vec) {
+  d2_reader *r = ctx;
+  int read = d2_read_box(r->f, vec);
+  r->error = read < 0;
+  return read > 0;
+}
+
+void _d2_consume(void *ctx, const void *vec) {
+  d2_sum *sum = ctx;
+  const vec3 v = *(const vec3 *)vec;
+  sum->total += sum->part == PART1 ? day2_formula1(v) : day2_formula2(v);
+}
+
+// Same as d2_solve, but parsing on a separate thread.
+uint32_t d2_solve_pipelined(FILE *f, const solution_part part) {
+  d2_reader reader = {.f = f, .error = false};
+  d2_sum sum = {.part = part, .total = 0};
+  pipeline_run(sizeof(vec3), _d2_produce, &reader, _d2_consume, &sum);
+  return reader.error ? (uint32_t)-1 : sum.total;
+}
+
+uint32_t d2_solve_boxes(const vec3 *boxes, usize n, const solution_part part) {
+  uint32_t total = 0;
+  for (usize i = 0; i < n; ++i) {
+    total += part == PART1 ? day2_formula1(boxes[i]) : day2_formula2(boxes[i]);
+  }
+  return total;
+}
+
+// Parse the whole input into an array of boxes, for cache_get.
+bool d2_parse_boxes(input_buf *in, void **payload, usize *len) {
+  vec3 *boxes = NULL;
+  line_iter it = line_iter_create(in->data, in->len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    vec3 box;
+    if (!d2_parse_box(line.ptr, &box)) {
+      fprintf(stderr, "error parsing vector: '%s'", line.ptr);
+      arr_free(boxes);
+      return false;
+    }
+    arr_push(boxes, box);
+  }
+  *len = arr_len(boxes) * sizeof(vec3);
+  *payload = cache_payload_copy(boxes, *len);
+  arr_free(boxes);
+  return true;
+}
+
+uint32_t day2(const solution_part part) {
+  cache_blob boxes;
+  if (!cache_get("day02", "data/input02.txt", d2_parse_boxes, &boxes)) {
+    return -1;
+  }
+  uint32_t total =
+      d2_solve_boxes(boxes.data, boxes.len / sizeof(vec3), part);
+  cache_blob_free(&boxes);
   return total;
 }
 
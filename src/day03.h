@@ -38,36 +38,86 @@ bool move(vec2 *pos, int c) {
   return true;
 }
 
-uint32_t day3(const solution_part part) {
+typedef enum { D3_HASHTABLE, D3_ROARING } d3_mode;
+
+typedef struct {
+  solution_part part;
+  d3_mode mode;
+  house *houses;  // D3_HASHTABLE: visit count per house
+  roaring visited; // D3_ROARING: set of packed house coordinates
+  vec2 santa_pos, robo_pos;
+  bool robo_santa;
+} d3_walker;
+
+// Pack coordinates so that each 256x256 block of houses shares its high 48
+// bits, i.e. lands in the same roaring container.
+static inline uint64_t d3_pack(vec2 pos) {
+  uint64_t ux = (uint32_t)pos.x ^ 0x80000000u;
+  uint64_t uy = (uint32_t)pos.y ^ 0x80000000u;
+  return (ux >> 8) << 40 | (uy >> 8) << 16 | (uy & 0xff) << 8 | (ux & 0xff);
+}
+
+void d3_visit(d3_walker *w, vec2 pos) {
+  if (w->mode == D3_HASHTABLE) {
+    inc_house(&w->houses, pos);
+  } else {
+    roaring_add(&w->visited, d3_pack(pos));
+  }
+}
+
+d3_walker d3_walker_create(const solution_part part, const d3_mode mode) {
+  d3_walker w = {.part = part,
+                 .mode = mode,
+                 .houses = NULL,
+                 .visited = roaring_create(),
+                 .santa_pos = {0, 0},
+                 .robo_pos = {0, 0},
+                 .robo_santa = false};
+  d3_visit(&w, w.santa_pos);
+  return w;
+}
+
+void d3_walker_step(d3_walker *w, int c) {
+  vec2 *pos = w->robo_santa ? &w->robo_pos : &w->santa_pos;
+  if (move(pos, c)) {
+    d3_visit(w, *pos);
+  }
+  if (w->part == PART2) {
+    w->robo_santa = !w->robo_santa;
+  }
+}
+
+// Number of distinct houses visited.
+uint64_t d3_walker_count(const d3_walker *w) {
+  return w->mode == D3_HASHTABLE ? ht_size(w->houses)
+                                 : roaring_cardinality(&w->visited);
+}
+
+void d3_walker_free(d3_walker *w) {
+  ht_free(w->houses);
+  roaring_free(&w->visited);
+}
+
+uint32_t day3(const solution_part part, const d3_mode mode) {
   FILE *f = fopen("data/input03.txt", "r");
   if (f == NULL) {
     perror("error opening input file");
     return -1;
   }
 
-  house *houses = NULL;
-  bool robo_santa = false;
-  vec2 santa_pos = {0, 0};
-  vec2 robo_pos = {0, 0};
-  vec2 *pos = &santa_pos;
-  inc_house(&houses, *pos);
-
+  d3_walker w = d3_walker_create(part, mode);
   while (true) {
     int c = fgetc(f);
     if (c == EOF) {
       break;
     }
-    if (move(pos, c)) {
-      inc_house(&houses, *pos);
-    }
-    if (part == PART2) {
-      pos = robo_santa ? &santa_pos : &robo_pos;
-      robo_santa = !robo_santa;
-    }
+    d3_walker_step(&w, c);
   }
   fclose(f);
-  return ht_size(houses);
+  uint32_t result = d3_walker_count(&w);
+  d3_walker_free(&w);
+  return result;
 }
 
-uint32_t day3_part1() { return day3(PART1); }
-uint32_t day3_part2() { return day3(PART2); }
+uint32_t day3_part1() { return day3(PART1, D3_ROARING); }
+uint32_t day3_part2() { return day3(PART2, D3_ROARING); }
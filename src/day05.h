@@ -2,10 +2,15 @@
 
 #include "common.h"
 #include "data_structures.h"
+#include "input.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 static inline bool is_vowel(char c) {
   return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
 }
@@ -74,20 +79,79 @@ bool is_nice2(const char *s) {
   return contains_two_pairs && contains_xyx;
 }
 
+// ==== Batch classifier for part 1 ====
+// Lines of up to 16 characters are checked with one register each: equality
+// masks for every letter of interest, shifted masks for pairs. Longer lines go
+// through is_nice.
+
+#if defined(__x86_64__) || defined(_M_X64)
+static inline u32 _d5_eq_mask(__m128i v, char c) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+// is_nice for a string of len <= 16 characters, 16 bytes at s must be readable.
+static inline bool d5_is_nice16(const char *s, usize len) {
+  const u32 valid = (1u << len) - 1;
+  const __m128i v = _mm_loadu_si128((const __m128i *)s);
+  u32 vowels = (_d5_eq_mask(v, 'a') | _d5_eq_mask(v, 'e') |
+                _d5_eq_mask(v, 'i') | _d5_eq_mask(v, 'o') |
+                _d5_eq_mask(v, 'u')) &
+               valid;
+  // bit i: s[i] == s[i + 1]
+  u32 doubles =
+      _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_srli_si128(v, 1))) & valid >> 1;
+  // bit i + 1: s[i], s[i + 1] is a forbidden pair
+  u32 forbidden = (_d5_eq_mask(v, 'a') << 1 & _d5_eq_mask(v, 'b')) |
+                  (_d5_eq_mask(v, 'c') << 1 & _d5_eq_mask(v, 'd')) |
+                  (_d5_eq_mask(v, 'p') << 1 & _d5_eq_mask(v, 'q')) |
+                  (_d5_eq_mask(v, 'x') << 1 & _d5_eq_mask(v, 'y'));
+  return popcount64(vowels) >= 3 && doubles != 0 && (forbidden & valid) == 0;
+}
+#endif
+
+// Number of nice lines (part 1 rules) in buf. Overwrites newlines with '\0',
+// buf needs len + 1 writable bytes (see line_iter_create).
+usize d5_count_nice(char *buf, usize len) {
+  usize count = 0;
+  line_iter it = line_iter_create(buf, len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+#if defined(__x86_64__) || defined(_M_X64)
+    if (line.len <= 16) {
+      if (line.ptr + 16 <= buf + len) {
+        count += d5_is_nice16(line.ptr, line.len);
+      } else {
+        char padded[16] = {0};
+        memcpy(padded, line.ptr, line.len);
+        count += d5_is_nice16(padded, line.len);
+      }
+      continue;
+    }
+#endif
+    count += is_nice(line.ptr);
+  }
+  return count;
+}
+
 uint32_t day5(const solution_part part) {
-  FILE *f = fopen("data/input05.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
+  input_buf in = input_read("data/input05.txt");
+  if (in.data == NULL) {
     return -1;
   }
-  char line[128];
+  if (part == PART1) {
+    uint32_t result = d5_count_nice(in.data, in.len);
+    input_free(&in);
+    return result;
+  }
   int result = 0;
-  while (fgets(line, 100, f) != NULL) {
-    if (part == PART1 ? is_nice(line) : is_nice2(line)) {
+  line_iter it = line_iter_create(in.data, in.len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    if (is_nice2(line.ptr)) {
       ++result;
     }
   }
-  fclose(f);
+  input_free(&in);
   return result;
 }
 
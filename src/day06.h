@@ -1,10 +1,13 @@
 #pragma once
 
+#include "cache.h"
 #include "common.h"
 #include "data_structures.h"
+#include "input.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <threads.h>
 
 bs_range_op parse_cmd(char *cmd) {
   if (cmd[4] == 'l')
@@ -14,68 +17,373 @@ bs_range_op parse_cmd(char *cmd) {
   return CLEAR;
 }
 
-void day06_perform_cmd(uint8_t *arr, solution_part part, char *cmd, uint16_t x1,
+#define D6_GRID_SIZE 1000
+
+// One byte per light for part 1, 16-bit brightness for part 2 (which would
+// wrap at 255 in a byte on dense inputs).
+grid day06_grid_create_sized(solution_part part, usize width, usize height) {
+  return part == PART1
+             ? grid_create_typed(uint8_t, width, height, GRID_TILED)
+             : grid_create_typed(uint16_t, width, height, GRID_TILED);
+}
+
+grid day06_grid_create(solution_part part) {
+  return day06_grid_create_sized(part, D6_GRID_SIZE, D6_GRID_SIZE);
+}
+
+typedef struct {
+  bs_range_op op;
+  uint32_t x1, y1, x2, y2; // corners, inclusive
+} d6_cmd;
+
+// Parse "turn on 0,0 through 999,999" and the like.
+bool day06_parse_line(const char *line, d6_cmd *cmd) {
+  if (expect_literal(&line, "turn on ")) {
+    cmd->op = SET;
+  } else if (expect_literal(&line, "turn off ")) {
+    cmd->op = CLEAR;
+  } else if (expect_literal(&line, "toggle ")) {
+    cmd->op = FLIP;
+  } else {
+    return false;
+  }
+  uint32_t x1, y1, x2, y2;
+  if (!parse_u32(&line, &x1) || !expect_literal(&line, ",") ||
+      !parse_u32(&line, &y1) || !expect_literal(&line, " through ") ||
+      !parse_u32(&line, &x2) || !expect_literal(&line, ",") ||
+      !parse_u32(&line, &y2)) {
+    return false;
+  }
+  if (x1 > x2 || y1 > y2 || x2 >= D6_GRID_SIZE || y2 >= D6_GRID_SIZE) {
+    return false;
+  }
+  *cmd = (d6_cmd){.op = cmd->op, .x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2};
+  return true;
+}
+
+typedef struct {
+  grid_span_fn fn;
+  const void *operand;
+} _d6_span_op;
+
+static const uint8_t _d6_u8[] = {0, 1};
+static const uint16_t _d6_u16[] = {1, 2};
+
+// Span kernel for each part and command, so the choice is made once per
+// rectangle.
+static const _d6_span_op _D6_OPS[2][3] = {
+    [PART1] = {[SET] = {grid_span_u8_fill, &_d6_u8[1]},
+               [CLEAR] = {grid_span_u8_fill, &_d6_u8[0]},
+               [FLIP] = {grid_span_u8_xor, &_d6_u8[1]}},
+    [PART2] = {[SET] = {grid_span_u16_add_sat, &_d6_u16[0]},
+               [CLEAR] = {grid_span_u16_sub_sat, &_d6_u16[0]},
+               [FLIP] = {grid_span_u16_add_sat, &_d6_u16[1]}},
+};
+
+// Apply the command to a grid made by day06_grid_create(part).
+void day06_apply(grid *g, solution_part part, d6_cmd cmd) {
+  const _d6_span_op op = _D6_OPS[part][cmd.op];
+  grid_rect_apply(g, cmd.x1, cmd.y1, cmd.x2, cmd.y2, op.fn, op.operand);
+}
+
+void day06_perform_cmd(grid *g, solution_part part, char *cmd, uint16_t x1,
                        uint16_t y1, uint16_t x2, uint16_t y2) {
-  bs_range_op op = parse_cmd(cmd);
-  for (size_t y = y1; y <= y2; ++y) {
-    for (size_t x = x1; x <= x2; ++x) {
-      uint8_t *elem = arr + x + y * 1000;
-      switch (op) {
-      case SET:
-        if (part == PART1) {
-          *elem = 1;
-        } else {
-          *elem += 1;
-        }
-        break;
-      case CLEAR:
-        if (part == PART1) {
-          *elem = 0;
-        } else {
-          *elem = (*elem == 0) ? 0 : *elem - 1;
-        }
-        break;
-      case FLIP:
-        if (part == PART1) {
-          *elem = (*elem == 0) ? 1 : 0;
-        } else {
-          *elem += 2;
-        }
-        break;
+  day06_apply(
+      g, part,
+      (d6_cmd){.op = parse_cmd(cmd), .x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2});
+}
+
+u64 day06_total(const grid *g) {
+  return grid_reduce(g, g->elem_size == 1 ? grid_span_u8_sum
+                                          : grid_span_u16_sum);
+}
+
+// ---- Bit-packed part 1 ----
+// One bit per light, rows of u64 words. A rectangle row is a head word, full
+// middle words and a tail word, and every command is the same masked update
+// w = (w & ~(m & clear)) ^ (m & flip), with clear and flip all ones or zeroes:
+// on clears then flips (OR), off only clears (AND-NOT), toggle only flips
+// (XOR).
+
+typedef struct {
+  usize width, height;
+  usize words; // per row
+  u64 *bits;
+} d6_bitgrid;
+
+d6_bitgrid d6_bitgrid_create(usize width, usize height) {
+  d6_bitgrid g = {.width = width, .height = height, .words = (width + 63) / 64};
+  g.bits = malloc_aligned(CACHE_LINE_SIZE,
+                          align_up(g.words * height * sizeof(u64),
+                                   CACHE_LINE_SIZE));
+  assert(g.bits);
+  memset(g.bits, 0, g.words * height * sizeof(u64));
+  return g;
+}
+
+void d6_bitgrid_free(d6_bitgrid *g) {
+  free_aligned(g->bits);
+  g->bits = NULL;
+}
+
+void d6_bitgrid_apply(d6_bitgrid *g, d6_cmd cmd) {
+  assert(cmd.x2 < g->width && cmd.y2 < g->height);
+  const u64 clear = cmd.op == FLIP ? 0 : ~0ULL;
+  const u64 flip = cmd.op == CLEAR ? 0 : ~0ULL;
+  const usize w1 = cmd.x1 / 64, w2 = cmd.x2 / 64;
+  u64 head = ~0ULL << (cmd.x1 % 64);
+  const u64 tail = ~0ULL >> (63 - cmd.x2 % 64);
+  if (w1 == w2)
+    head &= tail;
+  for (usize y = cmd.y1; y <= cmd.y2; ++y) {
+    u64 *row = g->bits + y * g->words;
+    row[w1] = (row[w1] & ~(head & clear)) ^ (head & flip);
+    for (usize w = w1 + 1; w < w2; ++w) {
+      row[w] = (row[w] & ~clear) ^ flip;
+    }
+    if (w2 > w1)
+      row[w2] = (row[w2] & ~(tail & clear)) ^ (tail & flip);
+  }
+}
+
+u64 d6_bitgrid_count(const d6_bitgrid *g) {
+  u64 total = 0;
+  for (usize i = 0; i < g->words * g->height; ++i) {
+    total += popcount64(g->bits[i]);
+  }
+  return total;
+}
+
+// ---- Row bands ----
+// Rows don't interact, so the grid is cut into horizontal bands of whole tile
+// rows, each a contiguous block of memory (tiles are stored one after another
+// and are a multiple of a cache line), and every band replays all the
+// commands clipped to its rows on its own thread.
+
+typedef struct {
+  grid *g;
+  solution_part part;
+  const d6_cmd *cmds;
+  usize n;
+  usize y1, y2; // rows of the band, inclusive
+  u64 total;
+} _d6_band;
+
+int _d6_band_worker(void *arg) {
+  _d6_band *b = arg;
+  for (usize i = 0; i < b->n; ++i) {
+    d6_cmd c = b->cmds[i];
+    if (c.y2 < b->y1 || c.y1 > b->y2)
+      continue;
+    c.y1 = max(c.y1, b->y1);
+    c.y2 = min(c.y2, b->y2);
+    day06_apply(b->g, b->part, c);
+  }
+  b->total = grid_rect_reduce(b->g, 0, b->y1, b->g->width - 1, b->y2,
+                              b->g->elem_size == 1 ? grid_span_u8_sum
+                                                   : grid_span_u16_sum);
+  return 0;
+}
+
+// Apply the commands to a grid made by day06_grid_create(part) with up to the
+// given number of threads (the calling one included), return the total.
+u64 day06_apply_banded(grid *g, solution_part part, const d6_cmd *cmds,
+                       usize n, usize threads) {
+  const usize tile_rows = align_up(g->height, GRID_TILE) / GRID_TILE;
+  const usize band_rows =
+      GRID_TILE * ((tile_rows + max(threads, 1) - 1) / max(threads, 1));
+  const usize bands = (g->height + band_rows - 1) / band_rows;
+  _d6_band *band = malloc(bands * sizeof(_d6_band));
+  thrd_t *handles = malloc(bands * sizeof(thrd_t));
+  bool *started = malloc(bands * sizeof(bool));
+  assert(band && handles && started);
+  for (usize i = 0; i < bands; ++i) {
+    band[i] = (_d6_band){.g = g,
+                         .part = part,
+                         .cmds = cmds,
+                         .n = n,
+                         .y1 = i * band_rows,
+                         .y2 = min(g->height, (i + 1) * band_rows) - 1};
+    // band 0 is left for the calling thread
+    started[i] = i > 0 && thrd_create(&handles[i], _d6_band_worker,
+                                      &band[i]) == thrd_success;
+  }
+  u64 total = 0;
+  for (usize i = 0; i < bands; ++i) {
+    if (started[i]) {
+      thrd_join(handles[i], NULL);
+    } else {
+      _d6_band_worker(&band[i]); // fewer threads, still correct
+    }
+    total += band[i].total;
+  }
+  free(started);
+  free(handles);
+  free(band);
+  return total;
+}
+
+// ---- Coordinate compression ----
+// The rectangle edges cut each axis into at most 2n + 1 intervals that every
+// rectangle covers either fully or not at all, so the grid is made of
+// elementary cells whose lights all end up the same. Each column of cells is
+// swept through the commands covering it, and the cells are weighted by their
+// area. The cost depends on the number of commands, not on the grid size.
+
+// Sorted distinct boundaries (first coordinate, and one past the last) of the
+// commands along one axis, into bounds (room for 2n). Returns their count.
+usize _d6_bounds(const d6_cmd *cmds, usize n, bool vertical, u32 *bounds) {
+  for (usize i = 0; i < n; ++i) {
+    bounds[2 * i] = vertical ? cmds[i].y1 : cmds[i].x1;
+    bounds[2 * i + 1] = (vertical ? cmds[i].y2 : cmds[i].x2) + 1;
+  }
+  sort_uint32_array(bounds, 2 * n);
+  usize count = 0;
+  for (usize i = 0; i < 2 * n; ++i) {
+    if (count == 0 || bounds[count - 1] != bounds[i])
+      bounds[count++] = bounds[i];
+  }
+  return count;
+}
+
+// Index of v in the sorted bounds, where it is known to be.
+static inline u32 _d6_bound_index(const u32 *bounds, usize count, u32 v) {
+  usize lo = 0, hi = count;
+  while (hi - lo > 1) {
+    usize mid = (lo + hi) / 2;
+    if (bounds[mid] <= v) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Apply a command (in cell indices) to a column of cells, with the choice of
+// operation made once for the whole run of cells.
+static inline void _d6_column_apply(u32 *column, solution_part part,
+                                    d6_cmd c) {
+  u32 *p = column + c.y1;
+  const usize n = c.y2 - c.y1;
+  if (part == PART1) {
+    switch (c.op) {
+    case SET:
+    case CLEAR: {
+      const u32 on = c.op == SET;
+      for (usize i = 0; i < n; ++i) {
+        p[i] = on;
       }
+      break;
     }
+    case FLIP:
+      for (usize i = 0; i < n; ++i) {
+        p[i] ^= 1;
+      }
+      break;
+    }
+    return;
+  }
+  switch (c.op) {
+  case SET:
+  case FLIP: {
+    const u32 add = c.op == SET ? 1 : 2;
+    for (usize i = 0; i < n; ++i) {
+      p[i] += add;
+    }
+    break;
+  }
+  case CLEAR:
+    for (usize i = 0; i < n; ++i) {
+      p[i] -= p[i] != 0;
+    }
+    break;
   }
 }
 
-int32_t day06_total(uint8_t *arr) {
-  uint32_t result = 0;
-  for (size_t i = 0; i < 1000 * 1000; ++i) {
-    result += arr[i];
+// Total brightness (or lights on for part 1) after all the commands, on a grid
+// of any size.
+u64 day06_compressed_total(const d6_cmd *cmds, usize n, solution_part part) {
+  if (n == 0)
+    return 0;
+  u32 *xs = malloc(2 * n * sizeof(u32));
+  u32 *ys = malloc(2 * n * sizeof(u32));
+  d6_cmd *cells = malloc(n * sizeof(d6_cmd)); // commands in cell indices
+  assert(xs && ys && cells);
+  const usize nx = _d6_bounds(cmds, n, false, xs);
+  const usize ny = _d6_bounds(cmds, n, true, ys);
+  for (usize i = 0; i < n; ++i) {
+    cells[i] = (d6_cmd){.op = cmds[i].op,
+                        .x1 = _d6_bound_index(xs, nx, cmds[i].x1),
+                        .y1 = _d6_bound_index(ys, ny, cmds[i].y1),
+                        .x2 = _d6_bound_index(xs, nx, cmds[i].x2 + 1),
+                        .y2 = _d6_bound_index(ys, ny, cmds[i].y2 + 1)};
   }
-  return result;
+
+  u32 *column = malloc(ny * sizeof(u32));
+  assert(column);
+  u64 total = 0;
+  for (usize x = 0; x + 1 < nx; ++x) {
+    memset(column, 0, ny * sizeof(u32));
+    for (usize i = 0; i < n; ++i) {
+      const d6_cmd c = cells[i];
+      if (x < c.x1 || x >= c.x2)
+        continue;
+      _d6_column_apply(column, part, c);
+    }
+    u64 column_total = 0;
+    for (usize y = 0; y + 1 < ny; ++y) {
+      column_total += (u64)column[y] * (ys[y + 1] - ys[y]);
+    }
+    total += column_total * (xs[x + 1] - xs[x]);
+  }
+  free(column);
+  free(cells);
+  free(ys);
+  free(xs);
+  return total;
+}
+
+// Parse the whole input into an array of d6_cmd, for cache_get.
+bool day06_parse_cmds(input_buf *in, void **payload, usize *len) {
+  d6_cmd *cmds = NULL;
+  line_iter it = line_iter_create(in->data, in->len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    d6_cmd cmd;
+    if (!day06_parse_line(line.ptr, &cmd)) {
+      fprintf(stderr, "couldn't parse line: '%s'", line.ptr);
+      arr_free(cmds);
+      return false;
+    }
+    arr_push(cmds, cmd);
+  }
+  *len = arr_len(cmds) * sizeof(d6_cmd);
+  *payload = cache_payload_copy(cmds, *len);
+  arr_free(cmds);
+  return true;
 }
 
 uint32_t day6(const solution_part part) {
-  FILE *f = fopen("data/input06.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
+  cache_blob cmds;
+  if (!cache_get("day06", "data/input06.txt", day06_parse_cmds, &cmds)) {
     return -1;
   }
-
-  uint8_t arr[1000 * 1000] = {0};
-  char line[128];
-  while (fgets(line, 100, f) != NULL) {
-    char cmd[32];
-    uint16_t x1, y1, x2, y2;
-    if (sscanf(line, "%16[a-z ] %hd,%hd through %hd,%hd\n", cmd, &x1, &y1, &x2,
-               &y2) != 5) {
-      fprintf(stderr, "couldn't parse line: '%s'", line);
-      exit(1);
+  const d6_cmd *cmd = cmds.data;
+  const usize n = cmds.len / sizeof(d6_cmd);
+  uint32_t result;
+  if (part == PART1) {
+    d6_bitgrid g = d6_bitgrid_create(D6_GRID_SIZE, D6_GRID_SIZE);
+    for (usize i = 0; i < n; ++i) {
+      d6_bitgrid_apply(&g, cmd[i]);
     }
-    day06_perform_cmd(arr, part, cmd, x1, y1, x2, y2);
+    result = d6_bitgrid_count(&g);
+    d6_bitgrid_free(&g);
+  } else {
+    result = day06_compressed_total(cmd, n, part);
   }
-  fclose(f);
-  return day06_total(arr);
+  cache_blob_free(&cmds);
+  return result;
 }
 
 uint32_t day6_part1() { return day6(PART1); }
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "arena.h"
+#include "cache.h"
 #include "common.h"
 #include "data_structures.h"
+#include "input.h"
 #include <ctype.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -173,21 +175,89 @@ uint16_t d7_eval_var(d7_machine *m, const char *var_name) {
   return result;
 }
 
-uint16_t day7(const solution_part part) {
-  FILE *f = fopen("data/input07.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
-    return -1;
+// Flat form of a signal definition, for caching: wire names are stored inline
+// and v1/v2 are integers if their bit is set in int_mask.
+typedef struct {
+  uint8_t tag;
+  uint8_t int_mask;
+  uint16_t i1, i2;
+  char out[8], s1[8], s2[8];
+} d7_gate;
+
+bool _d7_copy_name(const char *name, char *dst) {
+  if (strlen(name) >= 8)
+    return false;
+  strcpy(dst, name);
+  return true;
+}
+
+bool _d7_gate_value(d7_value v, uint8_t bit, uint8_t *int_mask, uint16_t *i,
+                    char *s) {
+  if (v.tag == D7_INTEGER) {
+    *int_mask |= bit;
+    *i = v.val.integer;
+    return true;
   }
+  return v.val.literal == NULL || _d7_copy_name(v.val.literal, s);
+}
 
+// Parse the whole input into an array of d7_gate, for cache_get.
+bool d7_parse_gates(input_buf *in, void **payload, usize *len) {
   d7_machine m = d7_machine_create(16 * 1024);
+  line_iter it = line_iter_create(in->data, in->len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    day07_process_line(&m, line.ptr);
+  }
+
+  usize n = sht_size(m.signals);
+  d7_gate *gates = calloc(max(n, 1), sizeof(d7_gate));
+  assert(gates);
+  bool ok = true;
+  for (usize i = 0; i < n && ok; ++i) {
+    d7_op op = m.signals[i].value;
+    d7_gate *g = &gates[i];
+    g->tag = op.tag;
+    ok = _d7_copy_name(m.signals[i].key, g->out) &&
+         _d7_gate_value(op.v1, 1, &g->int_mask, &g->i1, g->s1) &&
+         _d7_gate_value(op.v2, 2, &g->int_mask, &g->i2, g->s2);
+  }
+  d7_machine_free(&m);
+  if (!ok) {
+    fprintf(stderr, "wire name too long\n");
+    free(gates);
+    return false;
+  }
+  *payload = gates;
+  *len = n * sizeof(d7_gate);
+  return true;
+}
+
+d7_value _d7_gate_operand(d7_machine *m, const d7_gate *g, uint8_t bit,
+                          uint16_t i, const char *s) {
+  return g->int_mask & bit ? d7_value_int(i) : d7_value_literal(m, s);
+}
+
+void d7_load_gates(d7_machine *m, const d7_gate *gates, usize n) {
+  for (usize i = 0; i < n; ++i) {
+    const d7_gate *g = &gates[i];
+    d7_op op = {.tag = g->tag, .v1 = _d7_gate_operand(m, g, 1, g->i1, g->s1)};
+    if (g->tag != D7_ID && g->tag != D7_NOT) {
+      op.v2 = _d7_gate_operand(m, g, 2, g->i2, g->s2);
+    }
+    sht_put(m->signals, g->out, op);
+  }
+}
 
-  char line[128];
-  while (fgets(line, 100, f) != NULL) {
-    day07_process_line(&m, line);
+uint16_t day7(const solution_part part) {
+  cache_blob gates;
+  if (!cache_get("day07", "data/input07.txt", d7_parse_gates, &gates)) {
+    return -1;
   }
 
-  fclose(f);
+  d7_machine m = d7_machine_create(16 * 1024);
+  d7_load_gates(&m, gates.data, gates.len / sizeof(d7_gate));
+  cache_blob_free(&gates);
 
   uint16_t result_a = d7_eval_var(&m, "a");
   if (part == PART2) {
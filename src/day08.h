@@ -1,12 +1,14 @@
 #pragma once
 
 #include "common.h"
+#include "input.h"
+#include "input_stream.h"
 
 typedef struct {
   int16_t code_count, char_count, rep_count;
 } d8_result;
 
-d8_result d8_process_line(char *line) {
+d8_result d8_process_line(const char *line) {
   if (line[0] != '"') {
     perror("line does not start with a quote");
     exit(1);
@@ -46,23 +48,71 @@ d8_result d8_process_line(char *line) {
   exit(1);
 }
 
+// ==== Whole-buffer scanner ====
+// Same counts as d8_process_line, summed over a buffer of lines, from bitmasks
+// of backslashes, quotes, 'x' and newlines over 64 bytes at a time. Which
+// characters are escaped is worked out from the backslash mask with carries
+// instead of branches, like simdjson does. The input is not validated.
+
+typedef struct {
+  u64 code_count, char_count, rep_count;
+} d8_totals;
+
+// Mask of the characters escaped by a backslash. escaped_carry is 1 if the
+// first character of the block is escaped by the end of the previous one.
+static inline u64 _d8_escaped(u64 backslash, u64 *escaped_carry) {
+  const u64 even_bits = 0x5555555555555555ULL;
+  backslash &= ~*escaped_carry;
+  u64 follows_escape = backslash << 1 | *escaped_carry;
+  // runs of backslashes starting on odd bits, adding them to the backslash
+  // mask carries past the end of the run
+  u64 odd_starts = backslash & ~even_bits & ~follows_escape;
+  u64 even_runs = odd_starts + backslash;
+  *escaped_carry = even_runs < odd_starts;
+  return (even_bits ^ (even_runs << 1)) & follows_escape;
+}
+
+void d8_scan(const char *buf, usize len, d8_totals *totals) {
+  u64 escaped_carry = 0;
+  u64 escapes = 0, hex_escapes = 0, quotes = 0, backslashes = 0, newlines = 0;
+  char tail[64];
+  for (usize i = 0; i < len; i += 64) {
+    const char *p = buf + i;
+    if (i + 64 > len) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, p, len - i);
+      p = tail;
+    }
+    u64 backslash = byte_mask64(p, '\\');
+    u64 escaped = _d8_escaped(backslash, &escaped_carry);
+    escapes += popcount64(escaped);
+    hex_escapes += popcount64(escaped & byte_mask64(p, 'x'));
+    quotes += popcount64(byte_mask64(p, '"'));
+    backslashes += popcount64(backslash);
+    newlines += popcount64(byte_mask64(p, '\n'));
+  }
+  u64 lines = newlines + (len > 0 && buf[len - 1] != '\n');
+  u64 code = len - newlines;
+  // "\\" and "\"" are one character, "\xNN" too
+  totals->code_count += code;
+  totals->char_count += code - 2 * lines - escapes - 2 * hex_escapes;
+  // every '"' and '\\' gets escaped, plus the enclosing quotes
+  totals->rep_count += code + quotes + backslashes + 2 * lines;
+}
+
 uint16_t day8(const solution_part part) {
-  FILE *f = fopen("data/input08.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
+  input_source src;
+  if (!input_open(&src, "data/input08.txt", INPUT_STREAM)) {
     return -1;
   }
 
-  d8_result total = {.code_count = 0, .char_count = 0, .rep_count = 0};
-  char line[128];
-  while (fgets(line, 100, f) != NULL) {
-    d8_result cur = d8_process_line(line);
-    total.code_count += cur.code_count;
-    total.char_count += cur.char_count;
-    total.rep_count += cur.rep_count;
+  d8_totals total = {.code_count = 0, .char_count = 0, .rep_count = 0};
+  input_buf chunk;
+  while (input_next(&src, &chunk)) {
+    d8_scan(chunk.data, chunk.len, &total);
   }
 
-  fclose(f);
+  input_close(&src);
 
   return part == PART1 ? total.code_count - total.char_count
                        : total.rep_count - total.code_count;
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "cache.h"
 #include "common.h"
 #include "data_structures.h"
+#include "input.h"
 #include <limits.h>
 #include <stdint.h>
 
@@ -9,13 +11,14 @@
 
 typedef struct {
   strpool cities;
+  usize city_count;
 
   u16 dist[D9_MAX_CITIES][D9_MAX_CITIES];
   u16 dp[1 << D9_MAX_CITIES][D9_MAX_CITIES];
 } d9_state;
 
 d9_state d9_init_state(void) {
-  return (d9_state){.cities = strpool_init(), .dist = {0}};
+  return (d9_state){.cities = strpool_init(), .city_count = 0, .dist = {0}};
 }
 
 void d9_free_state(d9_state state) {
@@ -26,14 +29,21 @@ void d9_add_distance(d9_state *state, const char *s1, const char *s2,
                      u16 distance) {
   usize i1 = strpool_idx(&state->cities, s1);
   usize i2 = strpool_idx(&state->cities, s2);
+  state->city_count = strpool_len(&state->cities);
   state->dist[i1][i2] = distance;
   state->dist[i2][i1] = distance;
 }
 
 void d9_process_line(d9_state *state, const char *line) {
+  // London to Dublin = 464
+  const char *p = line;
+  strview w1, w2;
   char n1[16], n2[16];
-  u16 distance;
-  if (sscanf(line, "%15s to %15s = %hu", n1, n2, &distance) != 3) {
+  u32 distance;
+  if (!parse_word(&p, &w1) || !expect_literal(&p, " to ") ||
+      !parse_word(&p, &w2) || !expect_literal(&p, " = ") ||
+      !parse_u32(&p, &distance) || distance > UINT16_MAX ||
+      !strview_copy(w1, n1, sizeof(n1)) || !strview_copy(w2, n2, sizeof(n2))) {
     fprintf(stderr, "couldn't parse line '%s'\n", line);
     exit(1);
   }
@@ -44,12 +54,12 @@ bool d9_has_city(int mask, u8 city) { return mask & (1 << city); }
 int d9_remove_city(int mask, u8 city) { return mask & ~(1 << city); }
 
 int d9_full_mask(const d9_state *state) {
-  return (1 << strpool_len(&state->cities)) - 1;
+  return (1 << state->city_count) - 1;
 }
 
 u16 d9_held_karp(d9_state *state, const solution_part part) {
   int full_mask = d9_full_mask(state);
-  usize cities_count = strpool_len(&state->cities);
+  usize cities_count = state->city_count;
 
   // init dp array
   for (int mask = 0; mask <= full_mask; ++mask) {
@@ -85,22 +95,45 @@ u16 d9_held_karp(d9_state *state, const solution_part part) {
   return result;
 }
 
+// Cached form of the input: the distance matrix, city names are not needed.
+typedef struct {
+  u32 city_count;
+  u16 dist[D9_MAX_CITIES][D9_MAX_CITIES];
+} d9_input;
+
+bool d9_parse_input(input_buf *in, void **payload, usize *len) {
+  d9_state state = d9_init_state();
+  line_iter it = line_iter_create(in->data, in->len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    d9_process_line(&state, line.ptr);
+  }
+  d9_input input = {.city_count = state.city_count};
+  memcpy(input.dist, state.dist, sizeof(input.dist));
+  d9_free_state(state);
+  *len = sizeof(input);
+  *payload = cache_payload_copy(&input, *len);
+  return true;
+}
+
 u16 day9(const solution_part part) {
-  FILE *f = fopen("data/input09.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
+  cache_blob blob;
+  if (!cache_get("day09", "data/input09.txt", d9_parse_input, &blob)) {
     return -1;
   }
+  const d9_input *input = blob.data;
+  if (blob.len != sizeof(d9_input) || input->city_count > D9_MAX_CITIES) {
+    fprintf(stderr, "bad day 9 input\n");
+    exit(1);
+  }
 
   d9_state state = d9_init_state();
-  char line[128];
-  while (fgets(line, 100, f) != NULL) {
-    d9_process_line(&state, line);
-  }
+  state.city_count = input->city_count;
+  memcpy(state.dist, input->dist, sizeof(state.dist));
+  cache_blob_free(&blob);
 
   u16 result = d9_held_karp(&state, part);
 
-  fclose(f);
   d9_free_state(state);
 
   return result;
@@ -1,7 +1,8 @@
 #pragma once
 
-#include "../thirdparty/json.h"
 #include "common.h"
+#include "data_structures.h"
+#include "input.h"
 #include <assert.h>
 #include <ctype.h>
 #include <string.h>
@@ -15,112 +16,129 @@ d12_num_finder d12_init_num_finder(const char *s) {
   return (d12_num_finder){.input = s, .idx = 0};
 }
 
-bool d12_isnumchar(int c) { return c == '-' || isdigit(c); }
+// Plain range checks rather than isdigit: input bytes are plain char, which
+// may be negative for UTF-8 in strings, and these run on every byte.
+static inline bool d12_isdigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline bool d12_isnumchar(char c) { return c == '-' || d12_isdigit(c); }
 
 bool d12_next_num(d12_num_finder *finder, int *num) {
-  while (!d12_isnumchar(finder->input[finder->idx]) &&
-         finder->input[finder->idx] != '\0') {
-    ++finder->idx;
+  const char *p = finder->input + finder->idx;
+  while (!d12_isnumchar(*p) && *p != '\0') {
+    ++p;
   }
-  if (finder->input[finder->idx] == '\0')
+  if (*p == '\0') {
+    finder->idx = p - finder->input;
     return false;
-  int start = finder->idx;
-  do {
-    ++finder->idx;
-  } while (d12_isnumchar(finder->input[finder->idx]));
-  int len = finder->idx - start;
-  assert(len < 128);
-  char buf[128];
-  memcpy(buf, &finder->input[start], len);
-  buf[len] = '\0';
-  *num = atoi(buf);
-  return true;
-}
-
-bool d12_is_red(const struct json_object_s *obj) {
-  for (struct json_object_element_s *e = obj->start; e != NULL; e = e->next) {
-    struct json_string_s *val = json_value_as_string(e->value);
-    if (val != NULL && strcmp(val->string, "red") == 0) {
-      return true;
-    }
   }
-  return false;
-}
-
-int d12_sum_arr(const struct json_array_s *);
-int d12_sum_obj(const struct json_object_s *);
-
-int d12_sum_val(struct json_value_s *val) {
-  switch (val->type) {
-  case json_type_object:
-    return d12_sum_obj(json_value_as_object(val));
-  case json_type_array:
-    return d12_sum_arr(json_value_as_array(val));
-  case json_type_number:
-    return atoi(json_value_as_number(val)->number);
-  default: // do nothing
-    return 0;
+  bool negative = *p == '-';
+  p += negative;
+  int n = 0;
+  while (d12_isdigit(*p)) {
+    n = n * 10 + (*p++ - '0');
   }
+  *num = negative ? -n : n;
+  finder->idx = p - finder->input;
+  return true;
 }
 
-int d12_sum_arr(const struct json_array_s *arr) {
-  int sum = 0;
-  for (struct json_array_element_s *e = arr->start; e != NULL; e = e->next) {
-    sum += d12_sum_val(e->value);
+// Sum of all numbers in the null-terminated text.
+i64 d12_sum_all(const char *s) {
+  d12_num_finder finder = d12_init_num_finder(s);
+  i64 sum = 0;
+  int n;
+  while (d12_next_num(&finder, &n)) {
+    sum += n;
   }
   return sum;
 }
 
-int d12_sum_obj(const struct json_object_s *obj) {
-  if (d12_is_red(obj))
-    return 0;
-
-  int sum = 0;
-  for (struct json_object_element_s *e = obj->start; e != NULL; e = e->next) {
-    sum += d12_sum_val(e->value);
+typedef struct {
+  i64 sum;
+  bool is_object;
+  bool red; // an object with a "red" value, its sum is dropped
+} d12_frame;
+
+// Add n to the innermost open container, or to the total at the top level.
+static inline void d12_add(d12_frame *stack, i64 *total, i64 n) {
+  if (arr_len(stack) > 0) {
+    stack[arr_len(stack) - 1].sum += n;
+  } else {
+    *total += n;
   }
-  return sum;
 }
 
-int d12_sum_non_red(const char *s) {
-  struct json_value_s *root = json_parse(s, strlen(s));
-  return d12_sum_obj((struct json_object_s *)root->payload);
+// Close the innermost container, passing its sum on to the enclosing one.
+static inline void d12_close(d12_frame *stack, i64 *total) {
+  d12_frame f = arr_pop(stack);
+  d12_add(stack, total, f.is_object && f.red ? 0 : f.sum);
 }
 
-int day12(const solution_part part) {
-
-  FILE *f = fopen("data/input12.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
-    return -1;
+// Sum of all numbers in a json document, ignoring objects with a "red" value
+// and everything inside them. Single pass over the text, memory is one frame
+// per level of nesting.
+i64 d12_sum_stream(const char *s, usize len) {
+  d12_frame *stack = NULL;
+  i64 total = 0;
+  usize i = 0;
+  while (i < len) {
+    const char c = s[i];
+    if (c == '{' || c == '[') {
+      arr_push(stack, ((d12_frame){.is_object = c == '{'}));
+      ++i;
+    } else if (c == '}' || c == ']') {
+      if (arr_len(stack) > 0)
+        d12_close(stack, &total);
+      ++i;
+    } else if (c == '"') {
+      usize start = ++i;
+      while (i < len && s[i] != '"') {
+        i += s[i] == '\\' ? 2 : 1;
+      }
+      usize end = min(i, len);
+      ++i;
+      // keys are followed by ':', only values can make an object red
+      usize j = i;
+      while (j < len && isspace((unsigned char)s[j])) {
+        ++j;
+      }
+      bool is_key = j < len && s[j] == ':';
+      if (!is_key && arr_len(stack) > 0 && end - start == 3 &&
+          memcmp(s + start, "red", 3) == 0) {
+        d12_frame *top = &stack[arr_len(stack) - 1];
+        top->red = top->red || top->is_object;
+      }
+    } else if (d12_isnumchar(c)) {
+      bool negative = c == '-';
+      i += negative;
+      int n = 0;
+      while (i < len && d12_isdigit(s[i])) {
+        n = n * 10 + (s[i++] - '0');
+      }
+      d12_add(stack, &total, negative ? -n : n);
+    } else {
+      ++i;
+    }
   }
-
-  char line[1024 * 100];
-  if (fgets(line, 1024 * 100, f) == NULL) {
-    perror("error reading file");
-    return -1;
+  while (arr_len(stack) > 0) { // unterminated document
+    d12_close(stack, &total);
   }
-  fclose(f);
+  arr_free(stack);
+  return total;
+}
 
-  int sum = 0;
+i64 d12_sum_non_red(const char *s) { return d12_sum_stream(s, strlen(s)); }
 
-  switch (part) {
-  case PART1:
-    // using custom parser
-    d12_num_finder finder = d12_init_num_finder(line);
-    int n;
-    while (d12_next_num(&finder, &n)) {
-      sum += n;
-    }
-    break;
-  case PART2:
-    // using third-party json parser
-    return d12_sum_non_red(line);
-    break;
+i64 day12(const solution_part part) {
+  input_buf in = input_map("data/input12.txt");
+  if (in.data == NULL) {
+    return -1;
   }
-
+  i64 sum = part == PART1 ? d12_sum_all(in.data)
+                          : d12_sum_stream(in.data, in.len);
+  input_free(&in);
   return sum;
 }
 
-int day12_part1() { return day12(PART1); }
-int day12_part2() { return day12(PART2); }
+i64 day12_part1() { return day12(PART1); }
+i64 day12_part2() { return day12(PART2); }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "cache.h"
 #include "common.h"
 #include "data_structures.h"
+#include "input.h"
 #include <limits.h>
 
 #define D13_MAX_PEOPLE 9
@@ -24,17 +26,22 @@ void d13_add_cost(d13_state *state, char *n1, char *n2, int cost) {
 }
 
 void d13_process_line(d13_state *state, const char *line) {
-  char n1[16], n2[16], verb[5];
-  int cost;
   // Alice would gain 2 happiness units by sitting next to Bob.
-  if (sscanf(line,
-             "%15[a-zA-Z] would %4s %d happiness units by sitting next to "
-             "%15[a-zA-Z].",
-             n1, verb, &cost, n2) != 4) {
+  const char *p = line;
+  strview w1, w2;
+  char n1[16], n2[16];
+  bool gain;
+  u32 cost;
+  if (!parse_word(&p, &w1) || !expect_literal(&p, " would ") ||
+      !((gain = expect_literal(&p, "gain ")) || expect_literal(&p, "lose ")) ||
+      !parse_u32(&p, &cost) ||
+      !expect_literal(&p, " happiness units by sitting next to ") ||
+      !parse_word(&p, &w2) || !expect_literal(&p, ".") ||
+      !strview_copy(w1, n1, sizeof(n1)) || !strview_copy(w2, n2, sizeof(n2))) {
     fprintf(stderr, "couldn't parse line '%s'\n", line);
     exit(1);
   }
-  d13_add_cost(state, n1, n2, verb[0] == 'g' ? cost : 0 - cost);
+  d13_add_cost(state, n1, n2, gain ? (int)cost : -(int)cost);
 }
 
 void d13_swap(int *a, int *b) {
@@ -85,27 +92,48 @@ void d13_process(d13_state *state, const int *seating, usize size) {
   state->max_happiness = max(state->max_happiness, total);
 }
 
-int day13(const solution_part part) {
-
-  FILE *f = fopen("data/input13.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
-    return -1;
-  }
+// Cached form of the input: the cost matrix, names are not needed.
+typedef struct {
+  u32 people_count;
+  int cost[D13_MAX_PEOPLE][D13_MAX_PEOPLE];
+} d13_input;
 
+bool d13_parse_input(input_buf *in, void **payload, usize *len) {
   d13_state state = d13_init_state();
-  char line[128];
-  while (fgets(line, 100, f) != NULL) {
-    d13_process_line(&state, line);
+  line_iter it = line_iter_create(in->data, in->len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    d13_process_line(&state, line.ptr);
   }
+  d13_input input = {.people_count = strpool_len(&state.pool)};
+  memcpy(input.cost, state.cost, sizeof(input.cost));
+  strpool_free(&state.pool);
+  *len = sizeof(input);
+  *payload = cache_payload_copy(&input, *len);
+  return true;
+}
 
-  fclose(f);
+int day13(const solution_part part) {
+  cache_blob blob;
+  if (!cache_get("day13", "data/input13.txt", d13_parse_input, &blob)) {
+    return -1;
+  }
+  const d13_input *input = blob.data;
+  if (blob.len != sizeof(d13_input) ||
+      input->people_count >= D13_MAX_PEOPLE) {
+    fprintf(stderr, "bad day 13 input\n");
+    exit(1);
+  }
 
-  usize people_count = strpool_len(&state.pool);
+  d13_state state = d13_init_state();
+  usize people_count = input->people_count;
+  memcpy(state.cost, input->cost, sizeof(state.cost));
+  cache_blob_free(&blob);
 
   d13_permute(&state, part == PART1 ? people_count : people_count + 1,
               d13_process);
 
+  strpool_free(&state.pool);
   return state.max_happiness;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include "input.h"
 
 #define D14_MAX_DEERS 16
 #define D14_TIME_LIMIT 2503
@@ -26,15 +27,20 @@ void d14_add_deer(d14_context *ctx, d14_deer deer) {
 }
 
 void d14_process_line(d14_context *ctx, const char *line) {
-  char name[16];
-  d14_deer deer;
-  // Alice would gain 2 happiness units by sitting next to Bob.
-  if (sscanf(line,
-             "%15s can fly %d km/s for %d seconds, but then must rest for %d ",
-             name, &deer.fly_speed, &deer.fly_time, &deer.rest_time) != 4) {
+  // Vixen can fly 19 km/s for 7 seconds, but then must rest for 124 seconds.
+  const char *p = line;
+  strview name;
+  u32 speed, fly_time, rest_time;
+  if (!parse_word(&p, &name) || !expect_literal(&p, " can fly ") ||
+      !parse_u32(&p, &speed) || !expect_literal(&p, " km/s for ") ||
+      !parse_u32(&p, &fly_time) ||
+      !expect_literal(&p, " seconds, but then must rest for ") ||
+      !parse_u32(&p, &rest_time)) {
     fprintf(stderr, "couldn't parse line '%s'\n", line);
     exit(1);
   }
+  d14_deer deer = {
+      .fly_speed = speed, .fly_time = fly_time, .rest_time = rest_time};
   d14_add_deer(ctx, deer);
 }
 
@@ -80,19 +86,19 @@ int d14_new_scoring_winner(const d14_context ctx, const int seconds) {
 }
 
 int day14(const solution_part part) {
-  FILE *f = fopen("data/input14.txt", "r");
-  if (f == NULL) {
-    perror("error opening input file");
+  input_buf in = input_read("data/input14.txt");
+  if (in.data == NULL) {
     return -1;
   }
 
   d14_context ctx = d14_init_context();
-  char line[128];
-  while (fgets(line, 100, f) != NULL) {
-    d14_process_line(&ctx, line);
+  line_iter it = line_iter_create(in.data, in.len);
+  strview line;
+  while (line_iter_next(&it, &line)) {
+    d14_process_line(&ctx, line.ptr);
   }
 
-  fclose(f);
+  input_free(&in);
 
   if (part == PART1)
     return d14_max_distance_traveled(ctx, D14_TIME_LIMIT);
@@ -0,0 +1,213 @@
+/*
+Reading whole input files into memory (or mapping them) and splitting them into
+lines.
+
+Lines are found by a vectorized newline indexer that scans 64 bytes at a time
+(AVX2 if compiled with it, SSE2 on any x86-64, plain loop elsewhere) and emits
+newline offsets in bulk. The line iterator terminates each line in place, so
+the views it yields are also valid C strings.
+
+For examples of usage, see day05.h and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include <assert.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define INPUT_HAS_MMAP 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#define LINE_ITER_BATCH 1024 // newline offsets looked up at once
+
+typedef struct {
+  char *data; // null-terminated
+  usize len;
+  usize mapped_size; // 0 unless data is mmap'ed
+} input_buf;
+
+// Read the whole file into memory, data is NULL on error.
+input_buf input_read(const char *path) {
+  input_buf in = {.data = NULL, .len = 0, .mapped_size = 0};
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    perror("error opening input file");
+    return in;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size < 0) {
+    perror("error reading input file");
+    fclose(f);
+    return in;
+  }
+  in.data = malloc(size + 1);
+  assert(in.data);
+  in.len = fread(in.data, 1, size, f);
+  in.data[in.len] = '\0';
+  fclose(f);
+  return in;
+}
+
+// Map the file into memory, copy-on-write so it can be modified like a read
+// buffer. Falls back to input_read where mmap isn't available.
+input_buf input_map(const char *path) {
+#ifdef INPUT_HAS_MMAP
+  input_buf in = {.data = NULL, .len = 0, .mapped_size = 0};
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror("error opening input file");
+    if (fd >= 0)
+      close(fd);
+    return in;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return input_read(path);
+  }
+  // reserve one byte more than the file for the terminator, backed by an
+  // anonymous zero page if the file ends at a page boundary
+  usize size = st.st_size;
+  usize mapped_size = align_up(size + 1, sysconf(_SC_PAGESIZE));
+  char *base = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED ||
+      mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+           0) == MAP_FAILED) {
+    perror("error mapping input file");
+    if (base != MAP_FAILED)
+      munmap(base, mapped_size);
+    close(fd);
+    return in;
+  }
+  close(fd);
+  madvise(base, mapped_size, MADV_SEQUENTIAL);
+  base[size] = '\0';
+  return (input_buf){.data = base, .len = size, .mapped_size = mapped_size};
+#else
+  return input_read(path);
+#endif
+}
+
+void input_free(input_buf *in) {
+#ifdef INPUT_HAS_MMAP
+  if (in->mapped_size) {
+    munmap(in->data, in->mapped_size);
+    in->data = NULL;
+    in->len = in->mapped_size = 0;
+    return;
+  }
+#endif
+  free(in->data);
+  in->data = NULL;
+  in->len = 0;
+}
+
+// Bitmask of the positions of c in the 64 bytes at p.
+static inline u64 byte_mask64(const char *p, char c) {
+#if defined(__AVX2__)
+  const __m256i cv = _mm256_set1_epi8(c);
+  u32 lo = _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), cv));
+  u32 hi = _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 32)), cv));
+  return (u64)hi << 32 | lo;
+#elif defined(__x86_64__) || defined(_M_X64)
+  const __m128i cv = _mm_set1_epi8(c);
+  u64 mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i * 16));
+    mask |= (u64)(u16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cv)) << (i * 16);
+  }
+  return mask;
+#else
+  u64 mask = 0;
+  for (int i = 0; i < 64; ++i) {
+    mask |= (u64)(p[i] == c) << i;
+  }
+  return mask;
+#endif
+}
+
+// Store offsets of '\n' in buf[0..len) into offsets (room for cap of them, at
+// least 64), stopping early when offsets might not fit another block. Returns
+// the number of offsets stored, the number of bytes scanned goes to scanned.
+usize newline_index(const char *buf, usize len, usize *offsets, usize cap,
+                    usize *scanned) {
+  assert(cap >= 64);
+  usize n = 0;
+  usize i = 0;
+  for (; i + 64 <= len && n + 64 <= cap; i += 64) {
+    u64 mask = byte_mask64(buf + i, '\n');
+    while (mask) {
+      offsets[n++] = i + ctz64(mask);
+      mask &= mask - 1;
+    }
+  }
+  if (i + 64 > len && n + 64 <= cap) {
+    for (; i < len; ++i) {
+      if (buf[i] == '\n') {
+        offsets[n++] = i;
+      }
+    }
+  }
+  *scanned = i;
+  return n;
+}
+
+typedef struct {
+  char *buf;
+  usize len;
+  usize pos;     // start of the next line
+  usize scanned; // bytes already run through the indexer
+  usize offsets[LINE_ITER_BATCH];
+  usize count, next;
+} line_iter;
+
+// Iterate over the lines of buf[0, len). buf must have len + 1 writable bytes:
+// a last line without '\n' is terminated by writing '\0' at buf[len]. Buffers
+// from input_read/input_map and input_stream chunks always have that byte.
+line_iter line_iter_create(char *buf, usize len) {
+  return (line_iter){.buf = buf, .len = len};
+}
+
+// Yield the next line without its '\n', false at the end of the buffer. A
+// final line without '\n' is yielded too. Overwrites the '\n' (or buf[len]
+// for that final line) with '\0'.
+bool line_iter_next(line_iter *it, strview *line) {
+  if (it->next == it->count && it->scanned < it->len) {
+    usize scanned;
+    it->count = newline_index(it->buf + it->scanned, it->len - it->scanned,
+                              it->offsets, LINE_ITER_BATCH, &scanned);
+    for (usize i = 0; i < it->count; ++i) {
+      it->offsets[i] += it->scanned;
+    }
+    it->scanned += scanned;
+    it->next = 0;
+  }
+  usize end;
+  if (it->next < it->count) {
+    end = it->offsets[it->next++];
+  } else if (it->pos < it->len && it->scanned == it->len) {
+    end = it->len;
+  } else {
+    return false;
+  }
+  it->buf[end] = '\0';
+  *line = (strview){.ptr = it->buf + it->pos, .len = end - it->pos};
+  it->pos = end + 1;
+  return true;
+}
@@ -0,0 +1,523 @@
+/*
+Input sources: one API over reading a whole file, mapping it, or streaming it
+in chunks while the solver works on the previous ones.
+
+Streaming keeps INPUT_STREAM_BUFFERS page-aligned buffers in flight, through
+io_uring where available (linux 5.6+ for IORING_OP_READ, regular files),
+otherwise through a read-ahead thread (also used for pipes, and for "-" meaning
+stdin). Each chunk handed to the solver ends at a line boundary, the partial
+last line is carried over to the front of the next chunk, so chunks can be fed
+straight to line_iter.
+
+  input_source src;
+  if (!input_open(&src, path, INPUT_STREAM))
+    return -1;
+  input_buf chunk;
+  while (input_next(&src, &chunk)) {
+    line_iter it = line_iter_create(chunk.data, chunk.len);
+    ...
+  }
+  input_close(&src);
+
+For examples of usage, see day08.h and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include "input.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define INPUT_HAS_URING 1
+#endif
+
+#define INPUT_STREAM_BUFFERS 4
+#define INPUT_STREAM_BUF_SIZE (1024 * 1024)
+// room in front of each buffer for the carried over partial line, longer
+// lines are assembled in a separate buffer
+#define INPUT_STREAM_PREFIX (64 * 1024)
+#define INPUT_STREAM_ALIGN 4096
+
+typedef enum {
+  INPUT_READ,          // whole file read into memory
+  INPUT_MMAP,          // whole file mapped
+  INPUT_STREAM,        // chunks, io_uring if possible, else thread
+  INPUT_STREAM_THREAD, // chunks, always through a read-ahead thread
+} input_mode;
+
+typedef struct {
+  char *data; // INPUT_STREAM_PREFIX bytes past the allocation start
+  usize len;  // bytes filled
+  bool eof;   // no input after this buffer
+  enum { _BUF_EMPTY, _BUF_PENDING, _BUF_FILLED } state;
+} _input_stream_buf;
+
+typedef struct {
+  input_mode mode;
+  input_buf whole; // INPUT_READ, INPUT_MMAP
+  bool whole_done;
+
+  // streaming
+  _input_stream_buf bufs[INPUT_STREAM_BUFFERS];
+  usize seq;             // sequence number of the next buffer to hand out
+  isize held;            // index of the buffer the last chunk lives in, or -1
+  char *carry;           // partial line carried over to the next chunk
+  usize carry_len, carry_cap;
+  char *big;             // chunks with a carry too long for the prefix
+  usize big_cap;
+  bool done;
+  bool uring;
+
+#ifdef INPUT_HAS_URING
+  // io_uring backend
+  int fd;
+  int ring_fd;
+  u64 file_offset; // of the next read to submit
+  void *sq_ptr, *cq_ptr;
+  usize sq_size, cq_size;
+  struct io_uring_sqe *sqes;
+  usize sqes_size;
+  unsigned *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+#endif
+
+  // thread backend
+  FILE *file;
+  thrd_t thread;
+  mtx_t lock;
+  cnd_t cond;
+  bool stop;
+} input_source;
+
+// ==== io_uring backend ====
+
+#ifdef INPUT_HAS_URING
+
+// Whether the ring supports IORING_OP_READ. Kernels 5.1 to 5.5 set up rings
+// without it, and without IORING_REGISTER_PROBE either.
+bool _input_uring_has_read(int ring_fd) {
+  alignas(struct io_uring_probe) u8 buf[sizeof(struct io_uring_probe) +
+                                        256 * sizeof(struct io_uring_probe_op)];
+  memset(buf, 0, sizeof(buf));
+  struct io_uring_probe *probe = (struct io_uring_probe *)buf;
+  if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe,
+              256) < 0)
+    return false;
+  return probe->last_op >= IORING_OP_READ &&
+         (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+}
+
+bool _input_uring_setup(input_source *src) {
+  struct io_uring_params params = {0};
+  int ring_fd = syscall(__NR_io_uring_setup, INPUT_STREAM_BUFFERS, &params);
+  if (ring_fd < 0)
+    return false;
+  if (!_input_uring_has_read(ring_fd)) {
+    close(ring_fd);
+    return false;
+  }
+  src->ring_fd = ring_fd;
+  src->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  src->cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    src->sq_size = src->cq_size = max(src->sq_size, src->cq_size);
+  }
+  src->sq_ptr = mmap(NULL, src->sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  src->cq_ptr =
+      (params.features & IORING_FEAT_SINGLE_MMAP)
+          ? src->sq_ptr
+          : mmap(NULL, src->cq_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+  src->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  src->sqes = mmap(NULL, src->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (src->sq_ptr == MAP_FAILED || src->cq_ptr == MAP_FAILED ||
+      src->sqes == MAP_FAILED) {
+    if (src->sqes != MAP_FAILED)
+      munmap(src->sqes, src->sqes_size);
+    if (src->cq_ptr != MAP_FAILED && src->cq_ptr != src->sq_ptr)
+      munmap(src->cq_ptr, src->cq_size);
+    if (src->sq_ptr != MAP_FAILED)
+      munmap(src->sq_ptr, src->sq_size);
+    close(ring_fd);
+    return false;
+  }
+  u8 *sq = src->sq_ptr, *cq = src->cq_ptr;
+  src->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  src->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+  src->sq_array = (unsigned *)(sq + params.sq_off.array);
+  src->cq_head = (unsigned *)(cq + params.cq_off.head);
+  src->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  src->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+  src->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  return true;
+}
+
+// Queue a read filling the rest of buffer i, from where its data belongs in
+// the file. False if the kernel refused it.
+bool _input_uring_submit(input_source *src, usize i, u64 offset) {
+  _input_stream_buf *b = &src->bufs[i];
+  unsigned tail = *src->sq_tail;
+  unsigned idx = tail & *src->sq_mask;
+  struct io_uring_sqe *sqe = &src->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = src->fd;
+  sqe->addr = (u64)(uintptr_t)(b->data + b->len);
+  sqe->len = INPUT_STREAM_BUF_SIZE - b->len;
+  sqe->off = offset + b->len;
+  sqe->user_data = i | offset << 8;
+  src->sq_array[idx] = idx;
+  atomic_store_explicit((_Atomic unsigned *)src->sq_tail, tail + 1,
+                        memory_order_release);
+  if (syscall(__NR_io_uring_enter, src->ring_fd, 1, 0, 0, NULL, 0) < 0) {
+    // nothing was consumed, take the entry back so it isn't sent later
+    perror("io_uring_enter");
+    atomic_store_explicit((_Atomic unsigned *)src->sq_tail, tail,
+                          memory_order_release);
+    return false;
+  }
+  b->state = _BUF_PENDING;
+  return true;
+}
+
+// Start reading the next part of the file into empty buffer i.
+bool _input_uring_refill(input_source *src, usize i) {
+  src->bufs[i].len = 0;
+  src->bufs[i].eof = false;
+  bool ok = _input_uring_submit(src, i, src->file_offset);
+  src->file_offset += INPUT_STREAM_BUF_SIZE;
+  return ok;
+}
+
+// Wait for at least one completion and process all that are ready, false if
+// waiting failed.
+bool _input_uring_reap(input_source *src) {
+  while (syscall(__NR_io_uring_enter, src->ring_fd, 0, 1,
+                 IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+    if (errno != EINTR) {
+      perror("io_uring_enter");
+      return false;
+    }
+  }
+  unsigned head = *src->cq_head;
+  unsigned tail = atomic_load_explicit((_Atomic unsigned *)src->cq_tail,
+                                       memory_order_acquire);
+  for (; head != tail; ++head) {
+    struct io_uring_cqe *cqe = &src->cqes[head & *src->cq_mask];
+    usize i = cqe->user_data & 0xff;
+    u64 offset = cqe->user_data >> 8;
+    _input_stream_buf *b = &src->bufs[i];
+    if (cqe->res < 0) {
+      fprintf(stderr, "error reading input: %s\n", strerror(-cqe->res));
+      exit(1);
+    }
+    b->len += cqe->res;
+    if (cqe->res == 0 || b->len == INPUT_STREAM_BUF_SIZE) {
+      b->eof = cqe->res == 0;
+      b->state = _BUF_FILLED;
+    } else {
+      // short read, ask for the rest (gets 0 at the end of the file)
+      if (!_input_uring_submit(src, i, offset))
+        exit(1);
+    }
+  }
+  atomic_store_explicit((_Atomic unsigned *)src->cq_head, head,
+                        memory_order_release);
+  return true;
+}
+
+void _input_uring_close(input_source *src) {
+  // the kernel may still write into the buffers, wait for it
+  for (usize i = 0; i < INPUT_STREAM_BUFFERS; ++i) {
+    while (src->bufs[i].state == _BUF_PENDING && _input_uring_reap(src)) {
+    }
+  }
+  munmap(src->sqes, src->sqes_size);
+  if (src->cq_ptr != src->sq_ptr)
+    munmap(src->cq_ptr, src->cq_size);
+  munmap(src->sq_ptr, src->sq_size);
+  close(src->ring_fd);
+  close(src->fd);
+}
+
+#endif
+
+// ==== Read-ahead thread backend ====
+
+int _input_thread(void *arg) {
+  input_source *src = arg;
+  for (usize seq = 0;; ++seq) {
+    _input_stream_buf *b = &src->bufs[seq % INPUT_STREAM_BUFFERS];
+    mtx_lock(&src->lock);
+    while (b->state != _BUF_EMPTY && !src->stop) {
+      cnd_wait(&src->cond, &src->lock);
+    }
+    bool stop = src->stop;
+    mtx_unlock(&src->lock);
+    if (stop)
+      break;
+
+    usize len = fread(b->data, 1, INPUT_STREAM_BUF_SIZE, src->file);
+    if (len < INPUT_STREAM_BUF_SIZE && ferror(src->file)) {
+      perror("error reading input");
+      exit(1);
+    }
+    mtx_lock(&src->lock);
+    b->len = len;
+    b->eof = len < INPUT_STREAM_BUF_SIZE;
+    b->state = _BUF_FILLED;
+    cnd_broadcast(&src->cond);
+    mtx_unlock(&src->lock);
+    if (b->eof)
+      break;
+  }
+  return 0;
+}
+
+// ==== Common ====
+
+void _input_stream_free_bufs(input_source *src) {
+  for (usize i = 0; i < INPUT_STREAM_BUFFERS; ++i) {
+    free_aligned(src->bufs[i].data - INPUT_STREAM_PREFIX);
+    src->bufs[i].data = NULL;
+  }
+}
+
+bool _input_stream_open(input_source *src, const char *path) {
+  for (usize i = 0; i < INPUT_STREAM_BUFFERS; ++i) {
+    // one byte more for the terminator after a full buffer
+    char *alloc = malloc_aligned(
+        INPUT_STREAM_ALIGN, INPUT_STREAM_PREFIX + INPUT_STREAM_BUF_SIZE + 1);
+    assert(alloc);
+    src->bufs[i] = (_input_stream_buf){.data = alloc + INPUT_STREAM_PREFIX,
+                                       .state = _BUF_EMPTY};
+  }
+  src->held = -1;
+
+#ifdef INPUT_HAS_URING
+  struct stat st;
+  if (src->mode == INPUT_STREAM && strcmp(path, "-") != 0) {
+    src->fd = open(path, O_RDONLY);
+    if (src->fd < 0) {
+      perror("error opening input file");
+      _input_stream_free_bufs(src);
+      return false;
+    }
+    if (fstat(src->fd, &st) == 0 && S_ISREG(st.st_mode) &&
+        _input_uring_setup(src)) {
+      usize i = 0;
+      while (i < INPUT_STREAM_BUFFERS && _input_uring_refill(src, i)) {
+        ++i;
+      }
+      if (i == INPUT_STREAM_BUFFERS) {
+        src->uring = true;
+        return true;
+      }
+      // the ring can't take our reads, go through the thread instead
+      _input_uring_close(src);
+      for (usize j = 0; j < INPUT_STREAM_BUFFERS; ++j) {
+        src->bufs[j].len = 0;
+        src->bufs[j].eof = false;
+        src->bufs[j].state = _BUF_EMPTY;
+      }
+    } else {
+      close(src->fd);
+    }
+  }
+#endif
+
+  src->file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (src->file == NULL) {
+    perror("error opening input file");
+    _input_stream_free_bufs(src);
+    return false;
+  }
+  mtx_init(&src->lock, mtx_plain);
+  cnd_init(&src->cond);
+  if (thrd_create(&src->thread, _input_thread, src) != thrd_success) {
+    fprintf(stderr, "couldn't start reader thread\n");
+    mtx_destroy(&src->lock);
+    cnd_destroy(&src->cond);
+    if (src->file != stdin)
+      fclose(src->file);
+    _input_stream_free_bufs(src);
+    return false;
+  }
+  return true;
+}
+
+// Open the input in the given mode, false on error.
+bool input_open(input_source *src, const char *path, input_mode mode) {
+  *src = (input_source){.mode = mode};
+  switch (mode) {
+  case INPUT_READ:
+    src->whole = input_read(path);
+    return src->whole.data != NULL;
+  case INPUT_MMAP:
+    src->whole = input_map(path);
+    return src->whole.data != NULL;
+  case INPUT_STREAM:
+  case INPUT_STREAM_THREAD:
+    return _input_stream_open(src, path);
+  }
+  return false;
+}
+
+// Make sure a buffer has room for len bytes plus a terminator.
+void _input_reserve(char **buf, usize *cap, usize len) {
+  if (len + 1 > *cap) {
+    *cap = max(len + 1, *cap * 2);
+    *buf = realloc(*buf, *cap);
+    assert(*buf);
+  }
+}
+
+// Hand buffer i back to the reader.
+void _input_release(input_source *src, usize i) {
+#ifdef INPUT_HAS_URING
+  if (src->uring) {
+    src->bufs[i].state = _BUF_EMPTY;
+    if (!src->done && !_input_uring_refill(src, i)) {
+      exit(1);
+    }
+    return;
+  }
+#endif
+  mtx_lock(&src->lock);
+  src->bufs[i].state = _BUF_EMPTY;
+  cnd_broadcast(&src->cond);
+  mtx_unlock(&src->lock);
+}
+
+// Wait until buffer i is filled.
+void _input_wait(input_source *src, usize i) {
+#ifdef INPUT_HAS_URING
+  if (src->uring) {
+    while (src->bufs[i].state != _BUF_FILLED) {
+      if (!_input_uring_reap(src))
+        exit(1);
+    }
+    return;
+  }
+#endif
+  mtx_lock(&src->lock);
+  while (src->bufs[i].state != _BUF_FILLED) {
+    cnd_wait(&src->cond, &src->lock);
+  }
+  mtx_unlock(&src->lock);
+}
+
+// Get the next chunk of input, false when there is no more. The chunk ends
+// at a line boundary (except maybe the last one), is writable, has a
+// terminator at chunk.data[chunk.len] and stays valid until the next call.
+bool input_next(input_source *src, input_buf *chunk) {
+  if (src->mode == INPUT_READ || src->mode == INPUT_MMAP) {
+    if (src->whole_done)
+      return false;
+    src->whole_done = true;
+    *chunk = src->whole;
+    return true;
+  }
+
+  if (src->held >= 0) {
+    _input_release(src, src->held);
+    src->held = -1;
+  }
+  while (!src->done) {
+    usize i = src->seq++ % INPUT_STREAM_BUFFERS;
+    _input_wait(src, i);
+    _input_stream_buf *b = &src->bufs[i];
+    src->done = b->eof;
+
+    usize line_end = b->len;
+    while (line_end > 0 && b->data[line_end - 1] != '\n') {
+      --line_end;
+    }
+    if (line_end == 0) {
+      // no complete line in this buffer, keep all of it for later
+      _input_reserve(&src->carry, &src->carry_cap, src->carry_len + b->len);
+      memcpy(src->carry + src->carry_len, b->data, b->len);
+      src->carry_len += b->len;
+      _input_release(src, i);
+      continue;
+    }
+
+    if (src->carry_len <= INPUT_STREAM_PREFIX) {
+      chunk->data = b->data - src->carry_len;
+      if (src->carry_len > 0)
+        memcpy(chunk->data, src->carry, src->carry_len);
+    } else {
+      _input_reserve(&src->big, &src->big_cap, src->carry_len + line_end);
+      memcpy(src->big, src->carry, src->carry_len);
+      memcpy(src->big + src->carry_len, b->data, line_end);
+      chunk->data = src->big;
+    }
+    chunk->len = src->carry_len + line_end;
+    chunk->mapped_size = 0;
+
+    // the rest of the buffer starts the next chunk
+    src->carry_len = b->len - line_end;
+    _input_reserve(&src->carry, &src->carry_cap, src->carry_len);
+    memcpy(src->carry, b->data + line_end, src->carry_len);
+
+    // overwrites the first byte past the chunk, already saved in carry
+    chunk->data[chunk->len] = '\0';
+    src->held = i;
+    return true;
+  }
+
+  // last line without a trailing '\n'
+  if (src->carry_len > 0) {
+    _input_reserve(&src->carry, &src->carry_cap, src->carry_len);
+    *chunk = (input_buf){.data = src->carry, .len = src->carry_len};
+    chunk->data[chunk->len] = '\0';
+    src->carry_len = 0;
+    return true;
+  }
+  return false;
+}
+
+void input_close(input_source *src) {
+  switch (src->mode) {
+  case INPUT_READ:
+  case INPUT_MMAP:
+    input_free(&src->whole);
+    return;
+  case INPUT_STREAM:
+  case INPUT_STREAM_THREAD:
+    break;
+  }
+
+#ifdef INPUT_HAS_URING
+  if (src->uring) {
+    src->done = true;
+    _input_uring_close(src);
+  } else
+#endif
+  {
+    mtx_lock(&src->lock);
+    src->stop = true;
+    cnd_broadcast(&src->cond);
+    mtx_unlock(&src->lock);
+    thrd_join(src->thread, NULL);
+    if (src->file != stdin)
+      fclose(src->file);
+    mtx_destroy(&src->lock);
+    cnd_destroy(&src->cond);
+  }
+
+  _input_stream_free_bufs(src);
+  free(src->carry);
+  free(src->big);
+}
@@ -1,8 +1,10 @@
 
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 
 #include "../thirdparty/md5.c"
+#include "cache.h"
 #include "common.h"
 #include "day01.h"
 #include "day02.h"
@@ -18,15 +20,77 @@
 #include "day12.h"
 #include "day13.h"
 #include "day14.h"
+#include "md5_stream.h"
+#include "pow.h"
+
+// pow <prefix> <difficulty> [--resume]: day 4 style search with any prefix
+// and difficulty, checkpointed to POW_CHECKPOINT.
+int pow_main(const int argc, const char *argv[]) {
+  const char *prefix = argv[0];
+  uint32_t nibbles;
+  if (!str2uint32(argv[1], &nibbles) || nibbles < 1 ||
+      nibbles > POW_MAX_NIBBLES) {
+    printf("difficulty must be a number from 1 to %d\n", POW_MAX_NIBBLES);
+    return 1;
+  }
+  bool resume = argc == 3 && strcmp(argv[2], "--resume") == 0;
+  if (argc > 3 || (argc == 3 && !resume)) {
+    puts("usage: pow <prefix> <difficulty> [--resume]");
+    return 1;
+  }
+
+  pow_checkpoint ck = {.scanned = 0, .found = POW_NOT_FOUND};
+  if (resume) {
+    if (!pow_checkpoint_load(POW_CHECKPOINT, &ck)) {
+      puts("no checkpoint to resume from");
+      return 1;
+    }
+    if (strcmp(ck.prefix, prefix) != 0 || ck.nibbles != (int)nibbles) {
+      printf("checkpoint is for prefix '%s' difficulty %d\n", ck.prefix,
+             ck.nibbles);
+      return 1;
+    }
+    fprintf(stderr, "pow: resuming from %" PRIu64 "\n", ck.scanned);
+  }
+  pow_monitor mon = {
+      .checkpoint = POW_CHECKPOINT, .progress = true, .interval = 10};
+  printf("%" PRIu64 "\n", pow_search_monitored(prefix, nibbles, ck.scanned,
+                                                ck.found, cpu_count(), &mon));
+  return 0;
+}
+
+// md5 <file>: print the MD5 of a file, or of standard input for "-".
+int md5_main(const char *path) {
+  u8 digest[16];
+  if (!md5_path(path, digest))
+    return 1;
+  for (int i = 0; i < 16; ++i) {
+    printf("%02x", digest[i]);
+  }
+  printf("  %s\n", path);
+  return 0;
+}
 
 int main(const int argc, const char *argv[]) {
-  if (argc != 2) {
+  int arg = 1;
+  if (argc > 1 && strcmp(argv[1], "--cache") == 0) {
+    // keep parsed inputs in build/cache for the next runs
+    cache_enabled = true;
+    ++arg;
+  }
+  if (argc == arg + 2 && strcmp(argv[arg], "md5") == 0) {
+    return md5_main(argv[arg + 1]);
+  }
+  if (argc >= arg + 3 && strcmp(argv[arg], "pow") == 0) {
+    return pow_main(argc - arg - 1, argv + arg + 1);
+  }
+  if (argc != arg + 1) {
     puts("specify problem number");
     return 1;
   }
 
   uint32_t n;
-  bool ok = str2uint32(argv[1], &n);
+  bool ok = str2uint32(argv[arg], &n);
   if (!ok) {
     puts("argument must be a number");
     return 1;
@@ -34,8 +98,8 @@ int main(const int argc, const char *argv[]) {
 
   switch (n) {
   case 1:
-    printf("1.1: %zu\n", day1_part1());
-    printf("1.2: %zu\n", day1_part2());
+    printf("1.1: %" PRId64 "\n", day1_part1());
+    printf("1.2: %" PRId64 "\n", day1_part2());
     break;
   case 2:
     printf("2.1: %d\n", day2_part1());
@@ -82,8 +146,8 @@ int main(const int argc, const char *argv[]) {
     free(d11_2);
     break;
   case 12:
-    printf("12.1: %d\n", day12_part1());
-    printf("12.2: %d\n", day12_part2());
+    printf("12.1: %" PRId64 "\n", day12_part1());
+    printf("12.2: %" PRId64 "\n", day12_part2());
     break;
   case 13:
     printf("13.1: %d\n", day13_part1());
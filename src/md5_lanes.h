@@ -0,0 +1,271 @@
+/*
+Multi-lane MD5: hashes MD5_LANES single-block (up to 55 bytes) messages at
+once, one message per 32-bit lane of a vector register. 16 lanes with AVX-512,
+8 with AVX2, 4 with SSE2, and a plain 1-lane fallback elsewhere. Rounds are
+fully unrolled with the shifts and constants inlined.
+
+Messages are passed transposed: words[j][i] is the j-th little-endian word of
+message i, already padded (see md5_pad_block).
+
+For examples of usage, see day04.h and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include <assert.h>
+
+// Scalar u32 ops, used by md5_stream.h and the 1-lane fallback. The step
+// macros below take the op prefix (_md5_ or _md5s_) as their first argument.
+#define _md5s_set1(x) ((u32)(x))
+#define _md5s_add(x, y) ((x) + (y))
+#define _md5s_and(x, y) ((x) & (y))
+#define _md5s_or(x, y) ((x) | (y))
+#define _md5s_xor(x, y) ((x) ^ (y))
+#define _md5s_rotl(x, n) ((x) << (n) | (x) >> (32 - (n)))
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define MD5_LANES 16
+typedef __m512i md5_vec;
+#define _md5_set1(x) _mm512_set1_epi32((int)(x))
+#define _md5_load(p) _mm512_loadu_si512((const void *)(p))
+#define _md5_store(p, v) _mm512_storeu_si512((void *)(p), (v))
+#define _md5_add(x, y) _mm512_add_epi32((x), (y))
+#define _md5_and(x, y) _mm512_and_si512((x), (y))
+#define _md5_or(x, y) _mm512_or_si512((x), (y))
+#define _md5_xor(x, y) _mm512_xor_si512((x), (y))
+#define _md5_rotl(x, n) _mm512_rol_epi32((x), (n))
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define MD5_LANES 8
+typedef __m256i md5_vec;
+#define _md5_set1(x) _mm256_set1_epi32((int)(x))
+#define _md5_load(p) _mm256_loadu_si256((const __m256i *)(p))
+#define _md5_store(p, v) _mm256_storeu_si256((__m256i *)(p), (v))
+#define _md5_add(x, y) _mm256_add_epi32((x), (y))
+#define _md5_and(x, y) _mm256_and_si256((x), (y))
+#define _md5_or(x, y) _mm256_or_si256((x), (y))
+#define _md5_xor(x, y) _mm256_xor_si256((x), (y))
+#define _md5_rotl(x, n)                                                        \
+  _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MD5_LANES 4
+typedef __m128i md5_vec;
+#define _md5_set1(x) _mm_set1_epi32((int)(x))
+#define _md5_load(p) _mm_loadu_si128((const __m128i *)(p))
+#define _md5_store(p, v) _mm_storeu_si128((__m128i *)(p), (v))
+#define _md5_add(x, y) _mm_add_epi32((x), (y))
+#define _md5_and(x, y) _mm_and_si128((x), (y))
+#define _md5_or(x, y) _mm_or_si128((x), (y))
+#define _md5_xor(x, y) _mm_xor_si128((x), (y))
+#define _md5_rotl(x, n)                                                        \
+  _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+#else
+#define MD5_LANES 1
+typedef u32 md5_vec;
+#define _md5_set1(x) ((u32)(x))
+#define _md5_load(p) (*(const u32 *)(p))
+#define _md5_store(p, v) (*(u32 *)(p) = (v))
+#define _md5_add(x, y) _md5s_add(x, y)
+#define _md5_and(x, y) _md5s_and(x, y)
+#define _md5_or(x, y) _md5s_or(x, y)
+#define _md5_xor(x, y) _md5s_xor(x, y)
+#define _md5_rotl(x, n) _md5s_rotl(x, n)
+#endif
+
+#define MD5_IV_A 0x67452301
+#define MD5_IV_B 0xefcdab89
+#define MD5_IV_C 0x98badcfe
+#define MD5_IV_D 0x10325476
+
+// Round functions, in forms needing the fewest operations.
+#define _MD5_F(P, x, y, z) P##xor((z), P##and((x), P##xor((y), (z))))
+#define _MD5_G(P, x, y, z) P##xor((y), P##and((z), P##xor((x), (y))))
+#define _MD5_H(P, x, y, z) P##xor(P##xor((x), (y)), (z))
+#define _MD5_I(P, x, y, z)                                                     \
+  P##xor((y), P##or((x), P##xor((z), P##set1(0xffffffff))))
+
+#define _MD5_STEP(P, f, a, b, c, d, x, k, s)                                   \
+  a = P##add((b), P##rotl(P##add(P##add((a), _MD5_##f(P, (b), (c), (d))),     \
+                                 P##add((x), P##set1(k))),                     \
+                          (s)))
+
+static const u32 _MD5_K1[16] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821};
+
+// Round 1 from step skip on, falling through the rest of the steps. With a
+// constant skip of 0 the switch folds away.
+#define _MD5_ROUND1_FROM(P, skip, a, b, c, d, w)                               \
+  switch (skip) {                                                              \
+  case 0:                                                                      \
+    _MD5_STEP(P, F, a, b, c, d, w[0], _MD5_K1[0], 7);                          \
+  case 1:                                                                      \
+    _MD5_STEP(P, F, d, a, b, c, w[1], _MD5_K1[1], 12);                         \
+  case 2:                                                                      \
+    _MD5_STEP(P, F, c, d, a, b, w[2], _MD5_K1[2], 17);                         \
+  case 3:                                                                      \
+    _MD5_STEP(P, F, b, c, d, a, w[3], _MD5_K1[3], 22);                         \
+  case 4:                                                                      \
+    _MD5_STEP(P, F, a, b, c, d, w[4], _MD5_K1[4], 7);                          \
+  case 5:                                                                      \
+    _MD5_STEP(P, F, d, a, b, c, w[5], _MD5_K1[5], 12);                         \
+  case 6:                                                                      \
+    _MD5_STEP(P, F, c, d, a, b, w[6], _MD5_K1[6], 17);                         \
+  case 7:                                                                      \
+    _MD5_STEP(P, F, b, c, d, a, w[7], _MD5_K1[7], 22);                         \
+  case 8:                                                                      \
+    _MD5_STEP(P, F, a, b, c, d, w[8], _MD5_K1[8], 7);                          \
+  case 9:                                                                      \
+    _MD5_STEP(P, F, d, a, b, c, w[9], _MD5_K1[9], 12);                         \
+  case 10:                                                                     \
+    _MD5_STEP(P, F, c, d, a, b, w[10], _MD5_K1[10], 17);                       \
+  case 11:                                                                     \
+    _MD5_STEP(P, F, b, c, d, a, w[11], _MD5_K1[11], 22);                       \
+  case 12:                                                                     \
+    _MD5_STEP(P, F, a, b, c, d, w[12], _MD5_K1[12], 7);                        \
+  case 13:                                                                     \
+    _MD5_STEP(P, F, d, a, b, c, w[13], _MD5_K1[13], 12);                       \
+  case 14:                                                                     \
+    _MD5_STEP(P, F, c, d, a, b, w[14], _MD5_K1[14], 17);                       \
+  case 15:                                                                     \
+    _MD5_STEP(P, F, b, c, d, a, w[15], _MD5_K1[15], 22);                       \
+  }
+
+// Steps 16 to 60 on state a, b, c, d and message words w.
+#define _MD5_ROUNDS_2_TO_4(P, a, b, c, d, w)                                   \
+  _MD5_STEP(P, G, a, b, c, d, w[1], 0xf61e2562, 5);                          \
+  _MD5_STEP(P, G, d, a, b, c, w[6], 0xc040b340, 9);                          \
+  _MD5_STEP(P, G, c, d, a, b, w[11], 0x265e5a51, 14);                        \
+  _MD5_STEP(P, G, b, c, d, a, w[0], 0xe9b6c7aa, 20);                         \
+  _MD5_STEP(P, G, a, b, c, d, w[5], 0xd62f105d, 5);                          \
+  _MD5_STEP(P, G, d, a, b, c, w[10], 0x02441453, 9);                         \
+  _MD5_STEP(P, G, c, d, a, b, w[15], 0xd8a1e681, 14);                        \
+  _MD5_STEP(P, G, b, c, d, a, w[4], 0xe7d3fbc8, 20);                         \
+  _MD5_STEP(P, G, a, b, c, d, w[9], 0x21e1cde6, 5);                          \
+  _MD5_STEP(P, G, d, a, b, c, w[14], 0xc33707d6, 9);                         \
+  _MD5_STEP(P, G, c, d, a, b, w[3], 0xf4d50d87, 14);                         \
+  _MD5_STEP(P, G, b, c, d, a, w[8], 0x455a14ed, 20);                         \
+  _MD5_STEP(P, G, a, b, c, d, w[13], 0xa9e3e905, 5);                         \
+  _MD5_STEP(P, G, d, a, b, c, w[2], 0xfcefa3f8, 9);                          \
+  _MD5_STEP(P, G, c, d, a, b, w[7], 0x676f02d9, 14);                         \
+  _MD5_STEP(P, G, b, c, d, a, w[12], 0x8d2a4c8a, 20);                        \
+  _MD5_STEP(P, H, a, b, c, d, w[5], 0xfffa3942, 4);                          \
+  _MD5_STEP(P, H, d, a, b, c, w[8], 0x8771f681, 11);                         \
+  _MD5_STEP(P, H, c, d, a, b, w[11], 0x6d9d6122, 16);                        \
+  _MD5_STEP(P, H, b, c, d, a, w[14], 0xfde5380c, 23);                        \
+  _MD5_STEP(P, H, a, b, c, d, w[1], 0xa4beea44, 4);                          \
+  _MD5_STEP(P, H, d, a, b, c, w[4], 0x4bdecfa9, 11);                         \
+  _MD5_STEP(P, H, c, d, a, b, w[7], 0xf6bb4b60, 16);                         \
+  _MD5_STEP(P, H, b, c, d, a, w[10], 0xbebfbc70, 23);                        \
+  _MD5_STEP(P, H, a, b, c, d, w[13], 0x289b7ec6, 4);                         \
+  _MD5_STEP(P, H, d, a, b, c, w[0], 0xeaa127fa, 11);                         \
+  _MD5_STEP(P, H, c, d, a, b, w[3], 0xd4ef3085, 16);                         \
+  _MD5_STEP(P, H, b, c, d, a, w[6], 0x04881d05, 23);                         \
+  _MD5_STEP(P, H, a, b, c, d, w[9], 0xd9d4d039, 4);                          \
+  _MD5_STEP(P, H, d, a, b, c, w[12], 0xe6db99e5, 11);                        \
+  _MD5_STEP(P, H, c, d, a, b, w[15], 0x1fa27cf8, 16);                        \
+  _MD5_STEP(P, H, b, c, d, a, w[2], 0xc4ac5665, 23);                         \
+  _MD5_STEP(P, I, a, b, c, d, w[0], 0xf4292244, 6);                          \
+  _MD5_STEP(P, I, d, a, b, c, w[7], 0x432aff97, 10);                         \
+  _MD5_STEP(P, I, c, d, a, b, w[14], 0xab9423a7, 15);                        \
+  _MD5_STEP(P, I, b, c, d, a, w[5], 0xfc93a039, 21);                         \
+  _MD5_STEP(P, I, a, b, c, d, w[12], 0x655b59c3, 6);                         \
+  _MD5_STEP(P, I, d, a, b, c, w[3], 0x8f0ccc92, 10);                         \
+  _MD5_STEP(P, I, c, d, a, b, w[10], 0xffeff47d, 15);                        \
+  _MD5_STEP(P, I, b, c, d, a, w[1], 0x85845dd1, 21);                         \
+  _MD5_STEP(P, I, a, b, c, d, w[8], 0x6fa87e4f, 6);                          \
+  _MD5_STEP(P, I, d, a, b, c, w[15], 0xfe2ce6e0, 10);                        \
+  _MD5_STEP(P, I, c, d, a, b, w[6], 0xa3014314, 15);                         \
+  _MD5_STEP(P, I, b, c, d, a, w[13], 0x4e0811a1, 21);                        \
+  _MD5_STEP(P, I, a, b, c, d, w[4], 0xf7537e82, 6)
+
+// Steps 61 to 63, a is final before them.
+#define _MD5_LAST_STEPS(P, a, b, c, d, w)                                      \
+  _MD5_STEP(P, I, d, a, b, c, w[11], 0xbd3af235, 10);                        \
+  _MD5_STEP(P, I, c, d, a, b, w[2], 0x2ad7d2bb, 15);                         \
+  _MD5_STEP(P, I, b, c, d, a, w[9], 0xeb86d391, 21)
+
+// Pad a message of up to 55 bytes into a single 64-byte block, false if it
+// doesn't fit. msg may be the start of block itself.
+bool md5_pad_block(u8 block[64], const void *msg, usize len) {
+  if (len > 55)
+    return false;
+  memmove(block, msg, len);
+  block[len] = 0x80;
+  memset(block + len + 1, 0, 55 - len);
+  const u64 bits = (u64)len * 8;
+  for (int i = 0; i < 8; ++i) {
+    block[56 + i] = (u8)(bits >> (8 * i));
+  }
+  return true;
+}
+
+static inline u32 md5_le32(const u8 *p) {
+  return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+// Put words [from, to) of a padded block into lane i of transposed message
+// words.
+void md5_lanes_set_range(u32 words[16][MD5_LANES], usize lane,
+                         const u8 block[64], int from, int to) {
+  for (int j = from; j < to; ++j) {
+    words[j][lane] = md5_le32(block + 4 * j);
+  }
+}
+
+void md5_lanes_set(u32 words[16][MD5_LANES], usize lane, const u8 block[64]) {
+  md5_lanes_set_range(words, lane, block, 0, 16);
+}
+
+// State after the first steps of round 1 from the initial state, which only
+// read words w[0..steps). When those words are the same for every message (a
+// common prefix), this is computed once and md5_lanes_resume skips the steps.
+void md5_round1_state(const u32 w[16], int steps, u32 state[4]) {
+  static const u32 shifts[4] = {7, 12, 17, 22};
+  u32 v[4] = {MD5_IV_A, MD5_IV_B, MD5_IV_C, MD5_IV_D};
+  for (int i = 0; i < steps; ++i) {
+    // step i updates a, d, c, b in turn, with the roles rotating
+    const int t = (4 - i % 4) % 4;
+    const u32 x = v[(t + 1) % 4], y = v[(t + 2) % 4], z = v[(t + 3) % 4];
+    const u32 sum = v[t] + (z ^ (x & (y ^ z))) + w[i] + _MD5_K1[i];
+    v[t] = x + _md5s_rotl(sum, shifts[i % 4]);
+  }
+  memcpy(state, v, sizeof(v));
+}
+
+// Hash MD5_LANES padded blocks starting from the state after skip steps of
+// round 1 (see md5_round1_state). out[k][i] gets word k (a, b, c, d) of the
+// digest of message i. Digest bytes are the little-endian bytes of a, b, c, d.
+// With first_word_only, only out[0] is written, and the last 3 steps which
+// don't affect it are skipped.
+void md5_lanes_resume(const u32 words[16][MD5_LANES], const u32 state[4],
+                      int skip, bool first_word_only,
+                      u32 out[4][MD5_LANES]) {
+  assert(skip >= 0 && skip < 16);
+  md5_vec w[16];
+  for (int j = 0; j < 16; ++j) {
+    w[j] = _md5_load(words[j]);
+  }
+  md5_vec a = _md5_set1(state[0]), b = _md5_set1(state[1]),
+          c = _md5_set1(state[2]), d = _md5_set1(state[3]);
+  _MD5_ROUND1_FROM(_md5_, skip, a, b, c, d, w);
+  _MD5_ROUNDS_2_TO_4(_md5_, a, b, c, d, w);
+  _md5_store(out[0], _md5_add(a, _md5_set1(MD5_IV_A)));
+  if (first_word_only)
+    return;
+  _MD5_LAST_STEPS(_md5_, a, b, c, d, w);
+  _md5_store(out[1], _md5_add(b, _md5_set1(MD5_IV_B)));
+  _md5_store(out[2], _md5_add(c, _md5_set1(MD5_IV_C)));
+  _md5_store(out[3], _md5_add(d, _md5_set1(MD5_IV_D)));
+}
+
+// Hash MD5_LANES padded blocks, see md5_lanes_resume for the output.
+void md5_lanes(const u32 words[16][MD5_LANES], u32 out[4][MD5_LANES]) {
+  static const u32 iv[4] = {MD5_IV_A, MD5_IV_B, MD5_IV_C, MD5_IV_D};
+  md5_lanes_resume(words, iv, 0, false, out);
+}
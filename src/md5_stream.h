@@ -0,0 +1,137 @@
+/*
+Streaming MD5 for large inputs: files, pipes and buffers of any length.
+
+The compression function is md5_lanes.h's step list instantiated with scalar
+u32 ops. Whole 64-byte blocks are hashed straight from the caller's memory (an
+mmap'ed file or a large read buffer), only a partial block at the end of an
+update is staged for the next one. Regular files are mapped, pipes are read in
+MD5_STREAM_READ sized chunks.
+
+For examples of usage, see main.c and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include "input.h"
+#include "md5_lanes.h"
+#include <assert.h>
+
+#define MD5_STREAM_READ (1 << 20) // bytes read at once from pipes
+
+typedef struct {
+  u32 state[4];
+  u64 len;       // bytes hashed so far
+  u8 tail[64];   // partial block waiting for more input
+  usize tail_len;
+} md5_stream;
+
+// Run n consecutive 64-byte blocks at p through the compression function.
+void md5_blocks(u32 state[4], const u8 *p, usize n) {
+  u32 a = state[0], b = state[1], c = state[2], d = state[3];
+  for (; n > 0; --n, p += 64) {
+    u32 w[16];
+    for (int j = 0; j < 16; ++j) {
+      w[j] = md5_le32(p + 4 * j);
+    }
+    const u32 a0 = a, b0 = b, c0 = c, d0 = d;
+    _MD5_ROUND1_FROM(_md5s_, 0, a, b, c, d, w);
+    _MD5_ROUNDS_2_TO_4(_md5s_, a, b, c, d, w);
+    _MD5_LAST_STEPS(_md5s_, a, b, c, d, w);
+    a += a0;
+    b += b0;
+    c += c0;
+    d += d0;
+  }
+  state[0] = a;
+  state[1] = b;
+  state[2] = c;
+  state[3] = d;
+}
+
+void md5_stream_init(md5_stream *s) {
+  *s = (md5_stream){.state = {MD5_IV_A, MD5_IV_B, MD5_IV_C, MD5_IV_D}};
+}
+
+void md5_stream_update(md5_stream *s, const void *data, usize len) {
+  const u8 *p = data;
+  s->len += len;
+  if (s->tail_len > 0) {
+    usize n = min(len, 64 - s->tail_len);
+    memcpy(s->tail + s->tail_len, p, n);
+    s->tail_len += n;
+    p += n;
+    len -= n;
+    if (s->tail_len < 64)
+      return;
+    md5_blocks(s->state, s->tail, 1);
+    s->tail_len = 0;
+  }
+  md5_blocks(s->state, p, len / 64);
+  s->tail_len = len % 64;
+  memcpy(s->tail, p + len - s->tail_len, s->tail_len);
+}
+
+// Pad, hash the last block(s) and write the 16 digest bytes.
+void md5_stream_final(md5_stream *s, u8 digest[16]) {
+  u8 pad[128] = {0x80};
+  usize pad_len = (s->tail_len < 56 ? 56 : 120) - s->tail_len;
+  u64 bits = s->len * 8;
+  for (int i = 0; i < 8; ++i) {
+    pad[pad_len + i] = (u8)(bits >> (8 * i));
+  }
+  md5_stream_update(s, pad, pad_len + 8);
+  assert(s->tail_len == 0);
+  for (int i = 0; i < 16; ++i) {
+    digest[i] = (u8)(s->state[i / 4] >> (8 * (i % 4)));
+  }
+}
+
+void md5_buffer(const void *data, usize len, u8 digest[16]) {
+  md5_stream s;
+  md5_stream_init(&s);
+  md5_stream_update(&s, data, len);
+  md5_stream_final(&s, digest);
+}
+
+// Hash everything left in f, false on read errors.
+bool md5_stream_file(FILE *f, u8 digest[16]) {
+  u8 *buf = malloc_aligned(CACHE_LINE_SIZE, MD5_STREAM_READ);
+  assert(buf);
+  md5_stream s;
+  md5_stream_init(&s);
+  usize n;
+  while ((n = fread(buf, 1, MD5_STREAM_READ, f)) > 0) {
+    md5_stream_update(&s, buf, n);
+  }
+  bool ok = !ferror(f);
+  free_aligned(buf);
+  md5_stream_final(&s, digest);
+  return ok;
+}
+
+// Hash the file at path, or standard input for "-". Regular files are mapped,
+// anything else (pipes, devices) is read. False on errors.
+bool md5_path(const char *path, u8 digest[16]) {
+  if (strcmp(path, "-") == 0)
+    return md5_stream_file(stdin, digest);
+#ifdef INPUT_HAS_MMAP
+  struct stat st;
+  if (stat(path, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    input_buf in = input_map(path);
+    if (in.data == NULL)
+      return false;
+    md5_buffer(in.data, in.len, digest);
+    input_free(&in);
+    return true;
+  }
+#endif
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    perror("error opening input file");
+    return false;
+  }
+  bool ok = md5_stream_file(f, digest);
+  fclose(f);
+  return ok;
+}
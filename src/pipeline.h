@@ -0,0 +1,180 @@
+/*
+Bounded single-producer/single-consumer ring buffer, and a two-stage pipeline
+built on it: a reader thread parses records and pushes them in batches, the
+calling thread pops and consumes them.
+
+The head (consumer) and tail (producer) indices sit on separate cache lines,
+each side also keeps a cached copy of the other side's index so it only
+touches the shared line when the ring looks full/empty.
+
+For examples of usage, see day02.h and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+#define PIPELINE_BATCH 256
+
+typedef struct {
+  // producer side
+  alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+  usize head_cache;
+  // consumer side
+  alignas(CACHE_LINE_SIZE) atomic_size_t head;
+  usize tail_cache;
+  // read-only after creation
+  alignas(CACHE_LINE_SIZE) usize mask;
+  usize elem_size;
+  u8 *data;
+} spsc_ring;
+
+// Create a ring holding at least min_cap elements of elem_size bytes.
+spsc_ring *spsc_create(usize elem_size, usize min_cap) {
+  usize cap = 1;
+  while (cap < min_cap) {
+    cap <<= 1;
+  }
+  spsc_ring *ring = malloc_aligned(CACHE_LINE_SIZE, sizeof(spsc_ring));
+  assert(ring);
+  memset(ring, 0, sizeof(spsc_ring));
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  ring->mask = cap - 1;
+  ring->elem_size = elem_size;
+  ring->data = malloc_aligned(CACHE_LINE_SIZE, cap * elem_size);
+  assert(ring->data);
+  return ring;
+}
+
+void spsc_free(spsc_ring *ring) {
+  free_aligned(ring->data);
+  free_aligned(ring);
+}
+
+// Copy n elements between the ring slots starting at idx and items, wrapping.
+static inline void _spsc_copy(spsc_ring *ring, usize idx, void *items,
+                              usize n, bool to_ring) {
+  usize cap = ring->mask + 1;
+  usize first = min(n, cap - (idx & ring->mask));
+  u8 *slot = ring->data + (idx & ring->mask) * ring->elem_size;
+  u8 *rest = (u8 *)items + first * ring->elem_size;
+  if (to_ring) {
+    memcpy(slot, items, first * ring->elem_size);
+    memcpy(ring->data, rest, (n - first) * ring->elem_size);
+  } else {
+    memcpy(items, slot, first * ring->elem_size);
+    memcpy(rest, ring->data, (n - first) * ring->elem_size);
+  }
+}
+
+// Push up to n elements without blocking, return how many were pushed.
+// Producer thread only.
+usize spsc_push(spsc_ring *ring, const void *items, usize n) {
+  usize tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  usize cap = ring->mask + 1;
+  if (tail - ring->head_cache + n > cap) {
+    ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+  }
+  n = min(n, cap - (tail - ring->head_cache));
+  if (n == 0)
+    return 0;
+  _spsc_copy(ring, tail, (void *)items, n, true);
+  atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+  return n;
+}
+
+// Pop up to n elements without blocking, return how many were popped.
+// Consumer thread only.
+usize spsc_pop(spsc_ring *ring, void *items, usize n) {
+  usize head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (ring->tail_cache - head < n) {
+    ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  }
+  n = min(n, ring->tail_cache - head);
+  if (n == 0)
+    return 0;
+  _spsc_copy(ring, head, items, n, false);
+  atomic_store_explicit(&ring->head, head + n, memory_order_release);
+  return n;
+}
+
+// ==== Pipeline ====
+
+// Parse the next record into record, return false when there are no more.
+typedef bool (*pipeline_produce_fn)(void *ctx, void *record);
+typedef void (*pipeline_consume_fn)(void *ctx, const void *record);
+
+typedef struct {
+  spsc_ring *ring;
+  atomic_bool done;
+  pipeline_produce_fn produce;
+  void *ctx;
+} _pipeline_reader;
+
+int _pipeline_reader_thread(void *arg) {
+  _pipeline_reader *r = arg;
+  const usize elem_size = r->ring->elem_size;
+  u8 *batch = malloc(PIPELINE_BATCH * elem_size);
+  assert(batch);
+  bool more = true;
+  while (more) {
+    usize n = 0;
+    while (n < PIPELINE_BATCH &&
+           (more = r->produce(r->ctx, batch + n * elem_size))) {
+      ++n;
+    }
+    for (usize pushed = 0; pushed < n;) {
+      usize k = spsc_push(r->ring, batch + pushed * elem_size, n - pushed);
+      if (k == 0)
+        thrd_yield();
+      pushed += k;
+    }
+  }
+  free(batch);
+  atomic_store_explicit(&r->done, true, memory_order_release);
+  return 0;
+}
+
+// Run produce on a reader thread and consume on the calling thread, passing
+// records of record_size bytes through a ring buffer. Records are consumed in
+// the order they were produced.
+void pipeline_run(usize record_size, pipeline_produce_fn produce,
+                  void *produce_ctx, pipeline_consume_fn consume,
+                  void *consume_ctx) {
+  _pipeline_reader reader = {
+      .ring = spsc_create(record_size, PIPELINE_BATCH * 16),
+      .produce = produce,
+      .ctx = produce_ctx,
+  };
+  atomic_init(&reader.done, false);
+  thrd_t thread;
+  if (thrd_create(&thread, _pipeline_reader_thread, &reader) != thrd_success) {
+    fprintf(stderr, "couldn't start reader thread\n");
+    exit(1);
+  }
+
+  u8 *batch = malloc(PIPELINE_BATCH * record_size);
+  assert(batch);
+  while (true) {
+    // check done before popping, so records pushed right before it are seen
+    bool done = atomic_load_explicit(&reader.done, memory_order_acquire);
+    usize n = spsc_pop(reader.ring, batch, PIPELINE_BATCH);
+    for (usize i = 0; i < n; ++i) {
+      consume(consume_ctx, batch + i * record_size);
+    }
+    if (n == 0) {
+      if (done)
+        break;
+      thrd_yield();
+    }
+  }
+
+  thrd_join(thread, NULL);
+  free(batch);
+  spsc_free(reader.ring);
+}
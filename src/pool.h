@@ -0,0 +1,162 @@
+/*
+Toy fixed-size object pool allocator.
+
+Elements are carved out of aligned blocks of block_elems elements each, freed
+elements go to an intrusive free list (the link is stored in the element
+itself) and are reused first. Memory is only given back to the OS by
+pool_destroy.
+
+For multithreaded use, give each thread a pool_cache: it keeps a small private
+free list and only takes the pool's lock to move elements in batches.
+
+For examples of usage, see test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include "data_structures.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+#define POOL_CACHE_BATCH 64
+
+typedef struct _PoolFreeNode {
+  struct _PoolFreeNode *next;
+} _PoolFreeNode;
+
+typedef struct {
+  size_t elem_size;   // rounded up to hold a free list link, multiple of align
+  size_t align;       // of every element, at least that of a free list link
+  size_t block_elems; // elements allocated at once
+  void **blocks;      // dynamic array of all blocks, for pool_destroy
+  char *bump;         // next never-used element in the latest block
+  char *bump_end;
+  _PoolFreeNode *free_list;
+  atomic_flag lock; // only used by pool_cache_*
+} Pool;
+
+// Create a pool of elements of elem_size bytes aligned to elem_align (a power
+// of two), growing block_elems at a time.
+Pool pool_create(size_t elem_size, size_t elem_align, size_t block_elems) {
+  assert(block_elems > 0);
+  assert(elem_align > 0 && (elem_align & (elem_align - 1)) == 0);
+  const size_t align = max(elem_align, alignof(_PoolFreeNode));
+  elem_size = max(elem_size, sizeof(_PoolFreeNode));
+  elem_size = (elem_size + align - 1) & ~(align - 1);
+  return (Pool){.elem_size = elem_size,
+                .align = align,
+                .block_elems = block_elems,
+                .lock = ATOMIC_FLAG_INIT};
+}
+
+// Create a pool of elements of the given type.
+#define pool_create_typed(type, block_elems)                                   \
+  pool_create(sizeof(type), alignof(type), (block_elems))
+
+void _pool_add_block(Pool *pool) {
+  char *block =
+      malloc_aligned(pool->align, pool->elem_size * pool->block_elems);
+  assert(block);
+  arr_push(pool->blocks, (void *)block);
+  pool->bump = block;
+  pool->bump_end = block + pool->elem_size * pool->block_elems;
+}
+
+// Allocate one element. Contents are undefined.
+void *pool_alloc(Pool *pool) {
+  _PoolFreeNode *node = pool->free_list;
+  if (node != NULL) {
+    pool->free_list = node->next;
+    return node;
+  }
+  if (pool->bump == pool->bump_end) {
+    _pool_add_block(pool);
+  }
+  void *ptr = pool->bump;
+  pool->bump += pool->elem_size;
+  return ptr;
+}
+
+// Return an element allocated by pool_alloc to the pool.
+void pool_free(Pool *pool, void *ptr) {
+  _PoolFreeNode *node = ptr;
+  node->next = pool->free_list;
+  pool->free_list = node;
+}
+
+// Free all the blocks, making every element allocated from the pool invalid.
+void pool_destroy(Pool *pool) {
+  for (size_t i = 0; i < arr_len(pool->blocks); ++i) {
+    free_aligned(pool->blocks[i]);
+  }
+  arr_free(pool->blocks);
+  pool->bump = pool->bump_end = NULL;
+  pool->free_list = NULL;
+}
+
+// ==== Per-thread cache ====
+
+static inline void _pool_lock(Pool *pool) {
+  while (atomic_flag_test_and_set_explicit(&pool->lock, memory_order_acquire))
+    ;
+}
+
+static inline void _pool_unlock(Pool *pool) {
+  atomic_flag_clear_explicit(&pool->lock, memory_order_release);
+}
+
+typedef struct {
+  Pool *pool;
+  _PoolFreeNode *free_list;
+  size_t count;
+} pool_cache;
+
+pool_cache pool_cache_create(Pool *pool) {
+  return (pool_cache){.pool = pool, .free_list = NULL, .count = 0};
+}
+
+void *pool_cache_alloc(pool_cache *cache) {
+  if (cache->free_list == NULL) {
+    // refill a batch under the lock
+    _pool_lock(cache->pool);
+    for (size_t i = 0; i < POOL_CACHE_BATCH; ++i) {
+      _PoolFreeNode *node = pool_alloc(cache->pool);
+      node->next = cache->free_list;
+      cache->free_list = node;
+    }
+    _pool_unlock(cache->pool);
+    cache->count = POOL_CACHE_BATCH;
+  }
+  _PoolFreeNode *node = cache->free_list;
+  cache->free_list = node->next;
+  --cache->count;
+  return node;
+}
+
+// Give a batch of cached elements back to the pool, or all of them.
+void _pool_cache_flush(pool_cache *cache, size_t n) {
+  _pool_lock(cache->pool);
+  for (size_t i = 0; i < n && cache->free_list != NULL; ++i) {
+    _PoolFreeNode *node = cache->free_list;
+    cache->free_list = node->next;
+    pool_free(cache->pool, node);
+    --cache->count;
+  }
+  _pool_unlock(cache->pool);
+}
+
+void pool_cache_free(pool_cache *cache, void *ptr) {
+  _PoolFreeNode *node = ptr;
+  node->next = cache->free_list;
+  cache->free_list = node;
+  if (++cache->count > 2 * POOL_CACHE_BATCH) {
+    _pool_cache_flush(cache, POOL_CACHE_BATCH);
+  }
+}
+
+// Return all cached elements to the pool. Call before the thread exits.
+void pool_cache_release(pool_cache *cache) {
+  _pool_cache_flush(cache, cache->count);
+}
@@ -0,0 +1,371 @@
+/*
+MD5 proof-of-work search: the smallest nonce for which md5(prefix nonce) starts
+with a given number of zero hex digits (nibbles).
+
+The difficulty is turned into a mask over the digest words once, candidates
+are then hashed MD5_LANES at a time on the md5_lanes engine and checked word by
+word. Up to 8 nibbles only the first digest word matters, and the hash is cut
+short as soon as that word is known.
+
+For examples of usage, see day04.h and test.c
+*/
+
+#pragma once
+
+#include "common.h"
+#include "md5_lanes.h"
+#include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <time.h>
+
+#define POW_MAX_NIBBLES 32
+#define POW_CHUNK (64 * 1024) // nonces claimed by a thread at once
+#define POW_NOT_FOUND UINT64_MAX
+
+// Bits of each digest word (little-endian bytes of a, b, c, d) that must be
+// zero. words[i] is only looked at for i < count.
+typedef struct {
+  u32 words[4];
+  int count;
+} pow_mask;
+
+// Mask for difficulty leading zero nibbles, from 1 to POW_MAX_NIBBLES.
+pow_mask pow_mask_for(int nibbles) {
+  assert(nibbles >= 1 && nibbles <= POW_MAX_NIBBLES);
+  pow_mask mask = {.words = {0}, .count = (nibbles + 7) / 8};
+  for (int k = 0; k < nibbles; ++k) {
+    int byte = k / 2;
+    u32 nib = k % 2 == 0 ? 0xf0 : 0x0f; // high nibble is printed first
+    mask.words[byte / 4] |= nib << (8 * (byte % 4));
+  }
+  return mask;
+}
+
+// Padded message block "prefix nonce", with the nonce kept as ASCII digits
+// and incremented in place.
+typedef struct {
+  u8 block[64];
+  usize prefix_len;
+  usize len; // digits are block[prefix_len..len)
+} pow_msg;
+
+bool pow_msg_init(pow_msg *msg, const char *prefix, u64 nonce) {
+  char s[64];
+  int len = snprintf(s, sizeof(s), "%s%llu", prefix, (unsigned long long)nonce);
+  if (len < 0 || !md5_pad_block(msg->block, s, len))
+    return false;
+  msg->prefix_len = strlen(prefix);
+  msg->len = len;
+  return true;
+}
+
+// Increment the nonce, false if the message no longer fits a block.
+static inline bool pow_msg_next(pow_msg *msg) {
+  u8 *digits = msg->block + msg->prefix_len;
+  isize i = msg->len - msg->prefix_len - 1;
+  while (i >= 0 && digits[i] == '9') {
+    digits[i--] = '0';
+  }
+  if (i >= 0) {
+    ++digits[i];
+    return true;
+  }
+  // 99..9 -> 100..0, one byte longer
+  digits[0] = '1';
+  msg->block[msg->len++] = '0';
+  return md5_pad_block(msg->block, msg->block, msg->len);
+}
+
+// Whether the digest in lane passes every word of mask but the first.
+static inline bool _pow_rest_zero(const u32 digest[4][MD5_LANES],
+                                  const pow_mask *mask, usize lane) {
+  for (int k = 1; k < mask->count; ++k) {
+    if (digest[k][lane] & mask->words[k])
+      return false;
+  }
+  return true;
+}
+
+// Smallest nonce in [lo, hi) for which md5(prefix nonce) has all the bits of
+// mask zero, POW_NOT_FOUND if none.
+//
+// Candidates are hashed MD5_LANES at a time. Only the words holding digits
+// are rewritten for each candidate, and the round 1 steps reading only prefix
+// words are done once up front.
+u64 pow_scan(const char *prefix, const pow_mask *mask, u64 lo, u64 hi) {
+  pow_msg msg;
+  if (!pow_msg_init(&msg, prefix, lo)) {
+    fprintf(stderr, "prefix too long: '%s'\n", prefix);
+    exit(1);
+  }
+  const int skip = msg.prefix_len / 4;
+  u32 prefix_words[16];
+  for (int j = 0; j < skip; ++j) {
+    prefix_words[j] = md5_le32(msg.block + 4 * j);
+  }
+  u32 state[4];
+  md5_round1_state(prefix_words, skip, state);
+
+  const u32 first = mask->words[0];
+  const bool first_word_only = mask->count == 1;
+  u32 words[16][MD5_LANES];
+  u32 digest[4][MD5_LANES];
+  usize lane_len[MD5_LANES] = {0}; // message length last put in each lane
+  for (u64 base = lo; base < hi; base += MD5_LANES) {
+    for (usize lane = 0; lane < MD5_LANES; ++lane) {
+      if (lane_len[lane] != msg.len) {
+        md5_lanes_set(words, lane, msg.block);
+        lane_len[lane] = msg.len;
+      } else {
+        md5_lanes_set_range(words, lane, msg.block, skip, msg.len / 4 + 1);
+      }
+      if (!pow_msg_next(&msg)) {
+        fprintf(stderr, "nonce too long\n");
+        exit(1);
+      }
+    }
+    md5_lanes_resume(words, state, skip, first_word_only, digest);
+    for (usize lane = 0; lane < MD5_LANES; ++lane) {
+      if ((digest[0][lane] & first) == 0 && base + lane < hi &&
+          _pow_rest_zero(digest, mask, lane))
+        return base + lane;
+    }
+  }
+  return POW_NOT_FOUND;
+}
+
+// ==== Search ====
+
+// Optional reporting for long searches, done by the calling thread while the
+// workers scan.
+typedef struct {
+  const char *checkpoint; // file saved on every report, NULL for none
+  bool progress;          // print speed and ETA on stderr
+  double interval;        // seconds between reports
+} pow_monitor;
+
+typedef struct {
+  const char *prefix;
+  pow_mask mask;
+  u64 start;
+  atomic_uint_fast64_t next_chunk;
+  atomic_uint_fast64_t best; // smallest match found so far
+  atomic_size_t running;     // workers not done yet
+} pow_search_state;
+
+typedef struct {
+  pow_search_state *st;
+  atomic_uint_fast64_t scanning; // start of the chunk being scanned
+} _pow_worker_ctx;
+
+// Claim chunks in increasing order until they start past the best match. A
+// chunk below the best is always scanned to the end, so the final best is the
+// smallest match whatever the thread timing.
+int _pow_worker(void *arg) {
+  _pow_worker_ctx *w = arg;
+  pow_search_state *st = w->st;
+  while (true) {
+    u64 chunk = atomic_fetch_add(&st->next_chunk, 1);
+    u64 lo = st->start + chunk * POW_CHUNK;
+    // scanning stays on the previous (finished) chunk until here
+    atomic_store(&w->scanning, lo);
+    if (lo >= atomic_load(&st->best))
+      break;
+    u64 found = pow_scan(st->prefix, &st->mask, lo, lo + POW_CHUNK);
+    u64 best = atomic_load(&st->best);
+    while (found < best &&
+           !atomic_compare_exchange_weak(&st->best, &best, found))
+      ;
+  }
+  atomic_fetch_sub(&st->running, 1);
+  return 0;
+}
+
+// Every nonce below this has been scanned. A chunk is claimed before its
+// worker's scanning moves to it, so the smallest chunk start still being
+// scanned is a safe bound.
+u64 _pow_scanned(pow_search_state *st, _pow_worker_ctx *workers, usize n) {
+  u64 scanned = atomic_load(&st->best);
+  for (usize i = 0; i < n; ++i) {
+    scanned = min(scanned, atomic_load(&workers[i].scanning));
+  }
+  return scanned;
+}
+
+// ==== Checkpoints ====
+
+typedef struct {
+  char prefix[64];
+  int nibbles;
+  u64 scanned; // every nonce below this was scanned
+  u64 found;   // smallest match so far (maybe not the final one until
+               // scanned reaches it), POW_NOT_FOUND if none
+} pow_checkpoint;
+
+#define POW_CHECKPOINT "build/pow.checkpoint"
+
+// Write the checkpoint, through a temporary file so an interrupted write never
+// loses the previous one. False on errors.
+bool pow_checkpoint_save(const char *path, const pow_checkpoint *ck) {
+  char tmp_path[256];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE *f = fopen(tmp_path, "w");
+  if (f == NULL)
+    return false;
+  char found[32] = "none";
+  if (ck->found != POW_NOT_FOUND)
+    snprintf(found, sizeof(found), "%llu", (unsigned long long)ck->found);
+  bool ok = fprintf(f, "difficulty %d\nscanned %llu\nfound %s\nprefix %s\n",
+                    ck->nibbles, (unsigned long long)ck->scanned, found,
+                    ck->prefix) > 0;
+  ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+  // rename doesn't replace existing files on windows, elsewhere it does so
+  // atomically and the old checkpoint stays until the new one is in place
+  if (ok)
+    remove(path);
+#endif
+  if (!ok || rename(tmp_path, path) != 0) {
+    remove(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+bool _pow_checkpoint_read(const char *path, pow_checkpoint *ck) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    return false;
+  unsigned long long scanned;
+  char found[32];
+  bool ok = fscanf(f, "difficulty %d\nscanned %llu\nfound %31s\nprefix %63[^\n]",
+                   &ck->nibbles, &scanned, found, ck->prefix) == 4;
+  fclose(f);
+  if (!ok)
+    return false;
+  ck->scanned = scanned;
+  ck->found = POW_NOT_FOUND;
+  if (strcmp(found, "none") != 0) {
+    char *end;
+    ck->found = strtoull(found, &end, 10);
+    ok = *end == '\0';
+  }
+  return ok;
+}
+
+// Read a checkpoint written by pow_checkpoint_save, false if there is none or
+// it is malformed. Falls back to the temporary file, which is all there is if
+// a save was interrupted between removing the old file and renaming (windows).
+bool pow_checkpoint_load(const char *path, pow_checkpoint *ck) {
+  if (_pow_checkpoint_read(path, ck))
+    return true;
+  char tmp_path[256];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  return _pow_checkpoint_read(tmp_path, ck);
+}
+
+double _pow_now(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void _pow_report(u64 scanned, u64 best, int nibbles, double rate) {
+  // a match is certain once scanned reaches it, before that every nonce has
+  // the same chance and the expected wait doesn't shrink
+  double left = best != POW_NOT_FOUND ? (double)(best - scanned)
+                                      : ldexp(1.0, 4 * nibbles);
+  u64 eta = rate > 0 ? (u64)(left / rate) : 0;
+  fprintf(stderr, "pow: scanned %llu, %.2f MH/s, %s %llu:%02llu:%02llu\n",
+          (unsigned long long)scanned, rate * 1e-6,
+          best != POW_NOT_FOUND ? "done in" : "expected match in",
+          (unsigned long long)(eta / 3600),
+          (unsigned long long)(eta / 60 % 60), (unsigned long long)(eta % 60));
+}
+
+// Report and checkpoint every interval until the workers are done, and once
+// more at the end.
+void _pow_monitor(pow_search_state *st, _pow_worker_ctx *workers, usize n,
+                  const pow_monitor *mon, int nibbles) {
+  pow_checkpoint ck = {.nibbles = nibbles};
+  snprintf(ck.prefix, sizeof(ck.prefix), "%s", st->prefix);
+  double last_time = _pow_now();
+  u64 last_scanned = st->start;
+  while (true) {
+    thrd_sleep(&(struct timespec){.tv_nsec = 100 * 1000 * 1000}, NULL);
+    bool done = atomic_load(&st->running) == 0;
+    double now = _pow_now();
+    if (!done && now - last_time < mon->interval)
+      continue;
+    ck.found = atomic_load(&st->best);
+    ck.scanned = _pow_scanned(st, workers, n);
+    if (mon->checkpoint != NULL && !pow_checkpoint_save(mon->checkpoint, &ck))
+      perror("couldn't write checkpoint");
+    if (mon->progress)
+      _pow_report(ck.scanned, ck.found, nibbles,
+                  (ck.scanned - last_scanned) / (now - last_time));
+    if (done)
+      return;
+    last_time = now;
+    last_scanned = ck.scanned;
+  }
+}
+
+// Smallest nonce from start on for which md5(prefix nonce) starts with
+// difficulty_nibbles zero hex digits, searched by the given number of
+// threads. found is a match already known (from a checkpoint), or
+// POW_NOT_FOUND. With a monitor, the calling thread reports progress instead
+// of searching. Exits if the message outgrows a block first.
+u64 pow_search_monitored(const char *prefix, int difficulty_nibbles, u64 start,
+                         u64 found, usize threads, const pow_monitor *mon) {
+  pow_search_state st = {.prefix = prefix,
+                         .mask = pow_mask_for(difficulty_nibbles),
+                         .start = start};
+  atomic_init(&st.next_chunk, 0);
+  atomic_init(&st.best, found);
+  threads = max(threads, 1);
+  atomic_init(&st.running, 0);
+  _pow_worker_ctx *workers = malloc(threads * sizeof(_pow_worker_ctx));
+  thrd_t *handles = malloc(threads * sizeof(thrd_t));
+  assert(workers && handles);
+  for (usize i = 0; i < threads; ++i) {
+    workers[i].st = &st;
+    atomic_init(&workers[i].scanning, start);
+  }
+  // the calling thread is the last worker, unless it monitors
+  usize spawn = mon != NULL ? threads : threads - 1;
+  usize started = 0;
+  for (; started < spawn; ++started) {
+    atomic_fetch_add(&st.running, 1);
+    if (thrd_create(&handles[started], _pow_worker, &workers[started]) !=
+        thrd_success) {
+      atomic_fetch_sub(&st.running, 1);
+      break; // fewer threads, still correct
+    }
+  }
+  usize used = started;
+  if (mon == NULL || started == 0) {
+    atomic_fetch_add(&st.running, 1);
+    _pow_worker(&workers[used++]);
+  }
+  if (mon != NULL)
+    _pow_monitor(&st, workers, used, mon, difficulty_nibbles);
+  for (usize i = 0; i < started; ++i) {
+    thrd_join(handles[i], NULL);
+  }
+  free(handles);
+  free(workers);
+  return atomic_load(&st.best);
+}
+
+// Smallest nonce from start on for which md5(prefix nonce) starts with
+// difficulty_nibbles zero hex digits, searched by the given number of threads
+// (the calling one included). Exits if the message outgrows a block first.
+u64 pow_search(const char *prefix, int difficulty_nibbles, u64 start,
+               usize threads) {
+  return pow_search_monitored(prefix, difficulty_nibbles, start, POW_NOT_FOUND,
+                              threads, NULL);
+}
@@ -1,7 +1,15 @@
 #include "../thirdparty/acutest.h"
+#include "../thirdparty/md5.c"
 
 #include "arena.h"
+#include "cache.h"
 #include "data_structures.h"
+#include "pipeline.h"
+#include "pool.h"
+#include "day01.h"
+#include "day02.h"
+#include "day03.h"
+#include "day04.h"
 #include "day05.h"
 #include "day06.h"
 #include "day07.h"
@@ -12,6 +20,9 @@
 #include "day12.h"
 #include "day13.h"
 #include "day14.h"
+#include "input.h"
+#include "input_stream.h"
+#include "md5_stream.h"
 #include <stdint.h>
 
 #define TEST_DYN_ARRAY(type)                                                   \
@@ -245,6 +256,385 @@ void test_arena(void) {
   TEST_CHECK(arena.data == NULL);
 }
 
+void test_grid_helper(grid_flags flags) {
+  grid g = grid_create_typed(uint16_t, 100, 70, flags);
+  grid_at(&g, uint16_t, 99, 69) = 7;
+  grid_at(&g, uint16_t, 0, 0) = 3;
+  TEST_CHECK(grid_at(&g, uint16_t, 99, 69) == 7);
+  TEST_CHECK(grid_at(&g, uint16_t, 98, 69) == 0);
+  grid_free(&g);
+
+  g = grid_create_typed(uint8_t, 100, 70, flags);
+  const uint8_t one = 1, three = 3;
+  grid_rect_apply(&g, 10, 5, 89, 66, grid_span_u8_fill, &three);
+  grid_rect_apply(&g, 0, 0, 99, 69, grid_span_u8_sub_sat, &one);
+  TEST_CHECK(grid_reduce(&g, grid_span_u8_sum) == 80 * 62 * 2);
+  TEST_CHECK(grid_rect_reduce(&g, 0, 0, 10, 5, grid_span_u8_sum) == 2);
+  TEST_CHECK(grid_at(&g, uint8_t, 89, 66) == 2);
+  TEST_CHECK(grid_at(&g, uint8_t, 90, 66) == 0);
+  grid_rect_apply(&g, 0, 0, 99, 69, grid_span_u8_xor, &one);
+  TEST_CHECK(grid_reduce(&g, grid_span_u8_sum) ==
+             80 * 62 * 3 + (100 * 70 - 80 * 62));
+  usize len;
+  grid_span(&g, 60, 3, &len);
+  TEST_CHECK(len == ((flags & GRID_TILED) ? GRID_TILE - 60 : 40));
+  grid_free(&g);
+
+  g = grid_create_typed(uint16_t, 100, 70, flags);
+  const uint16_t big = 40000;
+  grid_rect_apply(&g, 10, 5, 89, 66, grid_span_u16_add_sat, &big);
+  TEST_CHECK(grid_reduce(&g, grid_span_u16_sum) == 80 * 62 * 40000ULL);
+  grid_rect_apply(&g, 0, 0, 99, 69, grid_span_u16_add_sat, &big);
+  TEST_CHECK(grid_at(&g, uint16_t, 89, 66) == UINT16_MAX);
+  TEST_CHECK(grid_at(&g, uint16_t, 90, 66) == 40000);
+  const uint16_t one16 = 1;
+  grid_rect_apply(&g, 0, 0, 99, 69, grid_span_u16_sub_sat, &big);
+  grid_rect_apply(&g, 0, 0, 99, 69, grid_span_u16_sub_sat, &one16);
+  TEST_CHECK(grid_reduce(&g, grid_span_u16_sum) ==
+             80 * 62 * (UINT16_MAX - 40001ULL));
+  TEST_CHECK(grid_rect_reduce(&g, 0, 0, 10, 5, grid_span_u16_sum) ==
+             UINT16_MAX - 40001);
+  grid_free(&g);
+}
+
+void test_grid(void) {
+  test_grid_helper(GRID_ROW_MAJOR);
+  test_grid_helper(GRID_TILED);
+  test_grid_helper(GRID_TILED | GRID_HUGE_PAGES);
+}
+
+void test_roaring(void) {
+  roaring r = roaring_create();
+  TEST_CHECK(!roaring_contains(&r, 5));
+
+  // sparse keys in separate containers
+  TEST_CHECK(roaring_add(&r, 5));
+  TEST_CHECK(!roaring_add(&r, 5));
+  TEST_CHECK(roaring_add(&r, 1ULL << 40));
+  TEST_CHECK(roaring_add(&r, UINT64_MAX));
+  TEST_CHECK(roaring_contains(&r, 1ULL << 40));
+  TEST_CHECK(!roaring_contains(&r, (1ULL << 40) + 1));
+  TEST_CHECK(roaring_cardinality(&r) == 3);
+
+  // dense container turns into a bitmap
+  for (uint64_t k = 0x10000; k < 0x20000; k += 3) {
+    roaring_add(&r, k);
+  }
+  TEST_CHECK(roaring_cardinality(&r) == 3 + 21846);
+  TEST_CHECK(roaring_contains(&r, 0x10000 + 3 * 1000));
+  TEST_CHECK(!roaring_contains(&r, 0x10000 + 3 * 1000 + 1));
+
+  // runs, including merging and extending them after optimizing
+  for (uint64_t k = 0x30000; k < 0x30100; ++k) {
+    if (k != 0x30080)
+      roaring_add(&r, k);
+  }
+  usize before = roaring_size_bytes(&r);
+  roaring_optimize(&r);
+  TEST_CHECK(roaring_size_bytes(&r) < before);
+  TEST_CHECK(!roaring_contains(&r, 0x30080));
+  TEST_CHECK(roaring_add(&r, 0x30080));
+  TEST_CHECK(roaring_add(&r, 0x30100));
+  TEST_CHECK(roaring_add(&r, 0x30200));
+  TEST_CHECK(!roaring_add(&r, 0x30050));
+  TEST_CHECK(roaring_contains(&r, 0x30080));
+  TEST_CHECK(!roaring_contains(&r, 0x30101));
+  TEST_CHECK(roaring_cardinality(&r) == 3 + 21846 + 256 + 2);
+
+  roaring_free(&r);
+  TEST_CHECK(r.containers == NULL);
+}
+
+void test_pool(void) {
+  Pool pool = pool_create_typed(pair, 4);
+  pair *items[10];
+  for (int i = 0; i < 10; ++i) {
+    items[i] = pool_alloc(&pool);
+    *items[i] = (pair){i, i * 2};
+  }
+  TEST_CHECK(arr_len(pool.blocks) == 3);
+  for (int i = 0; i < 10; ++i) {
+    TEST_CHECK(items[i]->x == i && items[i]->y == i * 2);
+  }
+
+  // freed elements are reused before growing
+  pool_free(&pool, items[3]);
+  pool_free(&pool, items[7]);
+  TEST_CHECK(pool_alloc(&pool) == items[7]);
+  TEST_CHECK(pool_alloc(&pool) == items[3]);
+  TEST_CHECK(arr_len(pool.blocks) == 3);
+
+  // per-thread cache takes batches from the pool and gives them back
+  pool_cache cache = pool_cache_create(&pool);
+  pair *p = pool_cache_alloc(&cache);
+  TEST_CHECK(cache.count == POOL_CACHE_BATCH - 1);
+  pool_cache_free(&cache, p);
+  pool_cache_release(&cache);
+  TEST_CHECK(cache.count == 0);
+  TEST_CHECK(pool_alloc(&pool) != NULL);
+
+  pool_destroy(&pool);
+  TEST_CHECK(pool.blocks == NULL);
+
+  // elements keep the alignment of their type, also past malloc's
+  typedef struct {
+    alignas(32) char c;
+  } wide;
+  Pool wide_pool = pool_create_typed(wide, 3);
+  for (int i = 0; i < 7; ++i) {
+    TEST_CHECK((uintptr_t)pool_alloc(&wide_pool) % 32 == 0);
+  }
+  pool_destroy(&wide_pool);
+}
+
+void test_spsc_ring(void) {
+  spsc_ring *ring = spsc_create(sizeof(int), 5);
+  TEST_CHECK(ring->mask == 7);
+  int in[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  int out[8] = {0};
+  TEST_CHECK(spsc_push(ring, in, 6) == 6);
+  TEST_CHECK(spsc_pop(ring, out, 4) == 4);
+  TEST_CHECK(out[0] == 1 && out[3] == 4);
+  // wraps around the end of the buffer, and stops when full
+  TEST_CHECK(spsc_push(ring, in, 8) == 6);
+  TEST_CHECK(spsc_push(ring, in, 1) == 0);
+  TEST_CHECK(spsc_pop(ring, out, 8) == 8);
+  TEST_CHECK(out[0] == 5 && out[1] == 6 && out[2] == 1 && out[7] == 6);
+  TEST_CHECK(spsc_pop(ring, out, 1) == 0);
+  spsc_free(ring);
+}
+
+bool test_pipeline_produce(void *ctx, void *record) {
+  int *next = ctx;
+  if (*next > 100000)
+    return false;
+  *(int *)record = (*next)++;
+  return true;
+}
+
+void test_pipeline_consume(void *ctx, const void *record) {
+  int *expected = ctx;
+  TEST_ASSERT(*(const int *)record == *expected);
+  ++*expected;
+}
+
+void test_pipeline(void) {
+  int next = 1, expected = 1;
+  pipeline_run(sizeof(int), test_pipeline_produce, &next,
+               test_pipeline_consume, &expected);
+  TEST_CHECK(expected == 100001);
+}
+
+void test_newline_index(void) {
+  char buf[200];
+  memset(buf, 'a', sizeof(buf));
+  buf[0] = buf[63] = buf[64] = buf[150] = buf[199] = '\n';
+  usize offsets[128];
+  usize scanned;
+  TEST_CHECK(newline_index(buf, sizeof(buf), offsets, 128, &scanned) == 5);
+  TEST_CHECK(scanned == sizeof(buf));
+  TEST_CHECK(offsets[0] == 0 && offsets[1] == 63 && offsets[2] == 64);
+  TEST_CHECK(offsets[3] == 150 && offsets[4] == 199);
+
+  // stops when another block might not fit
+  memset(buf, '\n', sizeof(buf));
+  TEST_CHECK(newline_index(buf, sizeof(buf), offsets, 128, &scanned) == 128);
+  TEST_CHECK(scanned == 128);
+}
+
+void test_line_iter(void) {
+  char small[] = "foo\n\nbar baz\nqux";
+  line_iter it = line_iter_create(small, strlen(small));
+  strview line;
+  TEST_CHECK(line_iter_next(&it, &line));
+  TEST_CHECK(line.len == 3 && strcmp(line.ptr, "foo") == 0);
+  TEST_CHECK(line_iter_next(&it, &line));
+  TEST_CHECK(line.len == 0 && strcmp(line.ptr, "") == 0);
+  TEST_CHECK(line_iter_next(&it, &line));
+  TEST_CHECK(line.len == 7 && strcmp(line.ptr, "bar baz") == 0);
+  TEST_CHECK(line_iter_next(&it, &line));
+  TEST_CHECK(line.len == 3 && strcmp(line.ptr, "qux") == 0);
+  TEST_CHECK(!line_iter_next(&it, &line));
+
+  // more lines than fit in one batch of offsets
+  char *big = NULL;
+  for (int i = 0; i < 5000; ++i) {
+    char num[16];
+    sprintf(num, "%d\n", i);
+    arr_push_str(&big, num);
+  }
+  it = line_iter_create(big, arr_len(big));
+  int expected = 0;
+  while (line_iter_next(&it, &line)) {
+    TEST_ASSERT(atoi(line.ptr) == expected);
+    ++expected;
+  }
+  TEST_CHECK(expected == 5000);
+  arr_free(big);
+}
+
+void test_parsers(void) {
+  const char *s = "  123x45 foo bar";
+  const char *p = s;
+  uint32_t n;
+  strview word = {0};
+  TEST_CHECK(!parse_u32(&p, &n));
+  skip_ws(&p);
+  TEST_CHECK(parse_u32(&p, &n) && n == 123);
+  TEST_CHECK(!expect_literal(&p, "xx"));
+  TEST_CHECK(p == s + 5);
+  TEST_CHECK(expect_literal(&p, "x"));
+  TEST_CHECK(parse_u32(&p, &n) && n == 45);
+  TEST_CHECK(!parse_word(&p, &word));
+  skip_ws(&p);
+  TEST_CHECK(parse_word(&p, &word));
+  TEST_CHECK(word.len == 3 && strncmp(word.ptr, "foo", 3) == 0);
+  char buf[4];
+  TEST_CHECK(strview_copy(word, buf, sizeof(buf)) && strcmp(buf, "foo") == 0);
+  TEST_CHECK(!strview_copy(word, buf, 3));
+
+  p = "4294967295 4294967296";
+  TEST_CHECK(parse_u32(&p, &n) && n == UINT32_MAX);
+  skip_ws(&p);
+  TEST_CHECK(!parse_u32(&p, &n));
+}
+
+void test_input_source(void) {
+  // lines of all lengths crossing buffer boundaries, one longer than the
+  // carry-over prefix, and no newline at the end
+  const char *path = "build/test_input_source.txt";
+  FILE *f = fopen(path, "wb");
+  TEST_ASSERT(f != NULL);
+  usize expected_lines = 0, expected_bytes = 0;
+  for (usize i = 0; expected_bytes < 3 * INPUT_STREAM_BUF_SIZE; ++i) {
+    usize len = i == 1000 ? INPUT_STREAM_PREFIX * 2 : i % 300;
+    for (usize j = 0; j < len; ++j) {
+      fputc('a' + (i + j) % 26, f);
+    }
+    fputc('\n', f);
+    ++expected_lines;
+    expected_bytes += len;
+  }
+  fputs("last", f);
+  ++expected_lines;
+  expected_bytes += 4;
+  fclose(f);
+
+  for (input_mode mode = INPUT_READ; mode <= INPUT_STREAM_THREAD; ++mode) {
+    input_source src;
+    TEST_ASSERT(input_open(&src, path, mode));
+#ifdef INPUT_HAS_URING
+    // io_uring may be unavailable (disabled, seccomp), then INPUT_STREAM
+    // falls back to the thread and reads the same bytes
+    TEST_CHECK(!src.uring || mode == INPUT_STREAM);
+#endif
+    usize lines = 0, bytes = 0;
+    bool ok = true;
+    strview line = {0};
+    input_buf chunk;
+    while (input_next(&src, &chunk)) {
+      line_iter it = line_iter_create(chunk.data, chunk.len);
+      while (line_iter_next(&it, &line)) {
+        if (line.len > 0 && line.ptr[0] != 'a' + lines % 26 && line.len != 4)
+          ok = false;
+        ++lines;
+        bytes += line.len;
+      }
+    }
+    TEST_CHECK(ok);
+    TEST_CHECK(lines == expected_lines);
+    TEST_CHECK(bytes == expected_bytes);
+    TEST_CHECK(strcmp(line.ptr, "last") == 0);
+    TEST_MSG("mode %d: %zu lines, %zu bytes", mode, lines, bytes);
+    input_close(&src);
+  }
+  remove(path);
+  for (input_mode mode = INPUT_READ; mode <= INPUT_STREAM_THREAD; ++mode) {
+    input_source src;
+    TEST_CHECK(!input_open(&src, path, mode));
+  }
+}
+
+int test_cache_parses = 0;
+
+bool test_cache_parse(input_buf *in, void **payload, usize *len) {
+  ++test_cache_parses;
+  *len = in->len;
+  *payload = cache_payload_copy(in->data, in->len);
+  return true;
+}
+
+void test_cache(void) {
+  const char *path = "build/test_cache_input.txt";
+  FILE *f = fopen(path, "wb");
+  TEST_ASSERT(f != NULL);
+  fputs("1x2x3\n4x5x6\n", f);
+  fclose(f);
+
+  // disabled: parse every time
+  cache_blob blob;
+  TEST_ASSERT(cache_get("test", path, test_cache_parse, &blob));
+  TEST_CHECK(blob.len == 12 && memcmp(blob.data, "1x2x3\n", 6) == 0);
+  cache_blob_free(&blob);
+  TEST_CHECK(test_cache_parses == 1);
+
+  // enabled: parse once, then map the cached payload
+  char cache_path[256];
+  input_buf in = input_read(path);
+  _cache_path(cache_path, sizeof(cache_path), "test",
+              cache_hash(in.data, in.len));
+  input_free(&in);
+  remove(cache_path); // left over from an earlier failed run
+  cache_enabled = true;
+  for (int i = 0; i < 2; ++i) {
+    TEST_ASSERT(cache_get("test", path, test_cache_parse, &blob));
+    TEST_CHECK(blob.len == 12 && memcmp(blob.data, "1x2x3\n", 6) == 0);
+    cache_blob_free(&blob);
+  }
+  TEST_CHECK(test_cache_parses == 2);
+  TEST_CHECK(remove(cache_path) == 0);
+
+  // different contents, different cache entry
+  f = fopen(path, "ab");
+  fputs("7x8x9\n", f);
+  fclose(f);
+  in = input_read(path);
+  _cache_path(cache_path, sizeof(cache_path), "test",
+              cache_hash(in.data, in.len));
+  input_free(&in);
+  TEST_ASSERT(cache_get("test", path, test_cache_parse, &blob));
+  TEST_CHECK(blob.len == 18);
+  cache_blob_free(&blob);
+  TEST_CHECK(test_cache_parses == 3);
+  TEST_CHECK(remove(cache_path) == 0);
+  cache_enabled = false;
+
+  TEST_ASSERT(cache_get("day02", path, d2_parse_boxes, &blob));
+  TEST_CHECK(blob.len == 3 * sizeof(vec3));
+  TEST_CHECK(d2_solve_boxes(blob.data, 3, PART2) ==
+             day2_formula2((vec3){1, 2, 3}) + day2_formula2((vec3){4, 5, 6}) +
+                 day2_formula2((vec3){7, 8, 9}));
+  cache_blob_free(&blob);
+  remove(path);
+}
+
+void test_splitter(void) {
+  splitter s = splitter_new("foo, bar,,baz qux", ", ");
+  strview v;
+  TEST_CHECK(splitter_next_view(&s, &v));
+  TEST_CHECK(v.len == 3 && strncmp(v.ptr, "foo", 3) == 0);
+  TEST_CHECK(splitter_next_view(&s, &v));
+  TEST_CHECK(v.len == 3 && strncmp(v.ptr, "bar", 3) == 0);
+  char token[4];
+  TEST_CHECK(splitter_next(&s, sizeof(token), token));
+  TEST_CHECK(strcmp(token, "baz") == 0);
+  // too long for the buffer, doesn't advance
+  TEST_CHECK(!splitter_next(&s, 3, token));
+  TEST_CHECK(splitter_next(&s, sizeof(token), token));
+  TEST_CHECK(strcmp(token, "qux") == 0);
+  TEST_CHECK(!splitter_next_view(&s, &v));
+}
+
 void test_strpool(void) {
   strpool pool = strpool_init();
   TEST_CHECK(strpool_idx(&pool, "foo") == 0);
@@ -253,9 +643,295 @@ void test_strpool(void) {
   TEST_CHECK(strpool_idx(&pool, "baz") == 2);
   TEST_CHECK(strpool_idx(&pool, "foo") == 0);
   TEST_CHECK(strpool_len(&pool) == 3);
+  TEST_CHECK(strpool_lookup(&pool, "bar") == 1);
+  TEST_CHECK(strpool_lookup(&pool, "qux") == -1);
+  TEST_CHECK(strpool_len(&pool) == 3);
+  TEST_CHECK(strcmp(strpool_get(&pool, 2), "baz") == 0);
+  strpool_free(&pool);
+}
+
+void test_strpool_growth(void) {
+  strpool pool = strpool_init();
+  TEST_CHECK(strpool_lookup(&pool, "meow1") == -1);
+  char key[16];
+  for (int i = 0; i < 100000; ++i) {
+    sprintf(key, "meow%d", i);
+    TEST_ASSERT(strpool_idx(&pool, key) == i);
+  }
+  TEST_CHECK(strpool_len(&pool) == 100000);
+  for (int i = 0; i < 100000; i += 7) {
+    sprintf(key, "meow%d", i);
+    TEST_CHECK(strpool_lookup(&pool, key) == i);
+    TEST_CHECK(strcmp(strpool_get(&pool, i), key) == 0);
+  }
+  TEST_CHECK(strpool_lookup(&pool, "meow100000") == -1);
   strpool_free(&pool);
 }
 
+void test_day01(void) {
+  TEST_CHECK(d1_floor("(()(()(", 7) == 3);
+  TEST_CHECK(d1_floor("))(((((", 7) == 3);
+  TEST_CHECK(d1_floor(")))", 3) == -3);
+  TEST_CHECK(d1_first_basement("(\n))", 4) == 4);
+  TEST_CHECK(d1_first_basement(")", 1) == 1);
+  TEST_CHECK(d1_first_basement("()())", 5) == 5);
+  TEST_CHECK(d1_first_basement("(((", 3) == 0);
+
+  // against a plain loop, climbing first so the fast paths get used
+  static char buf[4096];
+  uint64_t rng = 1;
+  for (int round = 0; round < 200; ++round) {
+    usize len = round * 20 % sizeof(buf);
+    int climb = round % 7 * 20;
+    for (usize i = 0; i < len; ++i) {
+      rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+      u32 r = rng >> 33;
+      buf[i] = r % 50 == 0 ? '\n' : (i < climb || r % 2) ? '(' : ')';
+      if (i >= climb && r % 5 == 0)
+        buf[i] = ')';
+    }
+    i64 floor = 0;
+    usize basement = 0;
+    for (usize i = 0; i < len; ++i) {
+      floor += (buf[i] == '(') - (buf[i] == ')');
+      if (floor < 0 && basement == 0)
+        basement = i + 1;
+    }
+    TEST_CHECK(d1_floor(buf, len) == floor);
+    TEST_CHECK(d1_first_basement(buf, len) == basement);
+    TEST_MSG("round %d: expected %zu, got %zu", round, basement,
+             d1_first_basement(buf, len));
+  }
+}
+
+void test_day02(void) {
+  FILE *f = tmpfile();
+  for (int i = 0; i < 10000; ++i) {
+    fprintf(f, "%dx%dx%d\n", i % 7 + 1, i % 11 + 1, i % 13 + 1);
+  }
+  for (solution_part part = PART1; part <= PART2; ++part) {
+    rewind(f);
+    uint32_t expected = d2_solve(f, part);
+    rewind(f);
+    TEST_CHECK(d2_solve_pipelined(f, part) == expected);
+  }
+  // a bad line fails the whole solve instead of exiting
+  fprintf(f, "2x3\n");
+  rewind(f);
+  TEST_CHECK(d2_solve(f, PART1) == (uint32_t)-1);
+  rewind(f);
+  TEST_CHECK(d2_solve_pipelined(f, PART1) == (uint32_t)-1);
+  fclose(f);
+
+  vec3 box;
+  TEST_CHECK(d2_parse_box("2x3x40", &box));
+  TEST_CHECK(box.x == 2 && box.y == 3 && box.z == 40);
+  TEST_CHECK(!d2_parse_box("2x3", &box));
+  TEST_CHECK(day2_formula1((vec3){2, 3, 4}) == 58);
+  TEST_CHECK(day2_formula2((vec3){1, 1, 10}) == 14);
+}
+
+uint64_t test_day03_helper(const char *moves, solution_part part,
+                           d3_mode mode) {
+  d3_walker w = d3_walker_create(part, mode);
+  for (usize i = 0; moves[i] != '\0'; ++i) {
+    d3_walker_step(&w, moves[i]);
+  }
+  uint64_t result = d3_walker_count(&w);
+  d3_walker_free(&w);
+  return result;
+}
+
+void test_day03(void) {
+  for (d3_mode mode = D3_HASHTABLE; mode <= D3_ROARING; ++mode) {
+    TEST_CHECK(test_day03_helper(">", PART1, mode) == 2);
+    TEST_CHECK(test_day03_helper("^>v<", PART1, mode) == 4);
+    TEST_CHECK(test_day03_helper("^v^v^v^v^v", PART1, mode) == 2);
+    TEST_CHECK(test_day03_helper("^v", PART2, mode) == 3);
+    TEST_CHECK(test_day03_helper("^>v<", PART2, mode) == 3);
+    TEST_CHECK(test_day03_helper("^v^v^v^v^v", PART2, mode) == 11);
+  }
+
+  // long walk crossing container boundaries in every direction
+  char moves[4001];
+  for (int i = 0; i < 4000; ++i) {
+    moves[i] = "^^>>vvv<<<<^"[i % 12];
+  }
+  moves[4000] = '\0';
+  TEST_CHECK(test_day03_helper(moves, PART1, D3_HASHTABLE) ==
+             test_day03_helper(moves, PART1, D3_ROARING));
+}
+
+void test_md5_lanes(void) {
+  u32 words[16][MD5_LANES];
+  u32 digest[4][MD5_LANES];
+  char msgs[MD5_LANES][64];
+  for (int round = 0; round < 8; ++round) {
+    for (usize lane = 0; lane < MD5_LANES; ++lane) {
+      // lengths 0 to 55, the most a single block holds
+      usize len = (round * MD5_LANES + lane) * 7 % 56;
+      for (usize i = 0; i < len; ++i) {
+        msgs[lane][i] = 'a' + (i * 3 + lane) % 26;
+      }
+      msgs[lane][len] = '\0';
+      u8 block[64];
+      TEST_ASSERT(md5_pad_block(block, msgs[lane], len));
+      md5_lanes_set(words, lane, block);
+    }
+    md5_lanes(words, digest);
+    for (usize lane = 0; lane < MD5_LANES; ++lane) {
+      u8 expected[16];
+      md5String(msgs[lane], expected);
+      for (int k = 0; k < 4; ++k) {
+        TEST_CHECK(digest[k][lane] == md5_le32(expected + 4 * k));
+      }
+    }
+  }
+  u8 block[64];
+  TEST_CHECK(!md5_pad_block(block, msgs[0], 56));
+}
+
+void test_md5_stream(void) {
+  char msg[300];
+  for (usize i = 0; i < sizeof(msg) - 1; ++i) {
+    msg[i] = 'a' + i * 7 % 26;
+  }
+  for (usize len = 0; len < sizeof(msg); ++len) {
+    char s[sizeof(msg)];
+    memcpy(s, msg, len);
+    s[len] = '\0';
+    u8 expected[16], digest[16];
+    md5String(s, expected);
+    md5_buffer(s, len, digest);
+    TEST_CHECK(memcmp(digest, expected, 16) == 0);
+    TEST_MSG("length %zu", len);
+    // the same, fed in uneven pieces
+    md5_stream st;
+    md5_stream_init(&st);
+    for (usize i = 0, piece = 1; i < len; i += piece, piece = piece * 3 % 71) {
+      md5_stream_update(&st, s + i, min(piece, len - i));
+    }
+    md5_stream_final(&st, digest);
+    TEST_CHECK(memcmp(digest, expected, 16) == 0);
+  }
+
+  // a file bigger than a read chunk, mapped and read
+  const char *path = "build/test_md5_stream.bin";
+  FILE *f = fopen(path, "wb");
+  TEST_ASSERT(f != NULL);
+  for (usize i = 0; i < MD5_STREAM_READ + 100; ++i) {
+    fputc((int)(i * 31 % 251), f);
+  }
+  fclose(f);
+  u8 expected[16], digest[16];
+  f = fopen(path, "rb");
+  md5File(f, expected);
+  fclose(f);
+  TEST_CHECK(md5_path(path, digest));
+  TEST_CHECK(memcmp(digest, expected, 16) == 0);
+  f = fopen(path, "rb");
+  TEST_CHECK(md5_stream_file(f, digest));
+  fclose(f);
+  TEST_CHECK(memcmp(digest, expected, 16) == 0);
+  remove(path);
+  TEST_CHECK(!md5_path("build/no_such_file", digest));
+}
+
+void test_day04(void) {
+  pow_msg msg;
+  TEST_ASSERT(pow_msg_init(&msg, "ab", 98));
+  for (int n = 98; n < 1002; ++n) {
+    u8 block[64];
+    char s[16];
+    md5_pad_block(block, s, sprintf(s, "ab%d", n));
+    TEST_CHECK(memcmp(block, msg.block, 64) == 0);
+    TEST_MSG("nonce %d", n);
+    TEST_ASSERT(pow_msg_next(&msg));
+  }
+
+  // resuming after the round 1 steps on a common prefix
+  u32 words[16][MD5_LANES], expected[4][MD5_LANES], digest[4][MD5_LANES];
+  for (usize lane = 0; lane < MD5_LANES; ++lane) {
+    char s[64];
+    u8 block[64];
+    int len = sprintf(s, "a common prefix of forty-eight bytes, then lane %zu",
+                      lane);
+    md5_pad_block(block, s, len);
+    md5_lanes_set(words, lane, block);
+  }
+  md5_lanes(words, expected);
+  for (int skip = 0; skip <= 12; ++skip) {
+    u32 prefix[16], state[4];
+    for (int j = 0; j < skip; ++j) {
+      prefix[j] = words[j][0];
+    }
+    md5_round1_state(prefix, skip, state);
+    md5_lanes_resume(words, state, skip, false, digest);
+    TEST_CHECK(memcmp(digest, expected, sizeof(digest)) == 0);
+    TEST_MSG("skip %d", skip);
+    memset(digest, 0, sizeof(digest));
+    md5_lanes_resume(words, state, skip, true, digest);
+    TEST_CHECK(memcmp(digest[0], expected[0], sizeof(digest[0])) == 0);
+  }
+
+  pow_mask five = pow_mask_for(5), six = pow_mask_for(6);
+  TEST_CHECK(five.count == 1 && five.words[0] == 0x00f0ffff);
+  TEST_CHECK(six.count == 1 && six.words[0] == 0x00ffffff);
+  pow_mask nine = pow_mask_for(9);
+  TEST_CHECK(nine.count == 2 && nine.words[0] == 0xffffffff &&
+             nine.words[1] == 0xf0);
+
+  TEST_CHECK(pow_scan("abcdef", &five, 609000, 610000) == 609043);
+  TEST_CHECK(pow_scan("abcdef", &five, 609000, 609043) == POW_NOT_FOUND);
+  // a mask over two digest words, against a plain search
+  pow_mask two_words = {.words = {0xf0, 0xf0}, .count = 2};
+  u64 expected_nonce = 0;
+  for (;; ++expected_nonce) {
+    char s[32];
+    u8 d[16];
+    sprintf(s, "abcdef%llu", (unsigned long long)expected_nonce);
+    md5String(s, d);
+    if (d[0] < 0x10 && d[4] < 0x10)
+      break;
+  }
+  TEST_CHECK(pow_scan("abcdef", &two_words, 0, 1000) == expected_nonce);
+  // same answer whatever the number of threads
+  for (usize threads = 1; threads <= 8; threads *= 2) {
+    TEST_CHECK(pow_search("pqrstuv", 5, 0, threads) == 1048970);
+    TEST_CHECK(pow_search("abcdef", 5, 400000, threads) == 609043);
+  }
+
+  // checkpoints, and resuming from them
+  const char *path = "build/test_pow.checkpoint";
+  pow_checkpoint ck = {.prefix = "a b", .nibbles = 7, .scanned = 123,
+                       .found = POW_NOT_FOUND};
+  TEST_ASSERT(pow_checkpoint_save(path, &ck));
+  pow_checkpoint loaded;
+  TEST_ASSERT(pow_checkpoint_load(path, &loaded));
+  TEST_CHECK(strcmp(loaded.prefix, "a b") == 0 && loaded.nibbles == 7 &&
+             loaded.scanned == 123 && loaded.found == POW_NOT_FOUND);
+  // a save interrupted right before its rename
+  char tmp_path[256];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  TEST_ASSERT(rename(path, tmp_path) == 0);
+  TEST_CHECK(pow_checkpoint_load(path, &loaded) && loaded.scanned == 123);
+  remove(tmp_path);
+  pow_monitor mon = {.checkpoint = path, .progress = false, .interval = 0.01};
+  for (usize threads = 1; threads <= 4; threads *= 2) {
+    TEST_CHECK(pow_search_monitored("abcdef", 5, 400000, POW_NOT_FOUND,
+                                    threads, &mon) == 609043);
+    TEST_ASSERT(pow_checkpoint_load(path, &loaded));
+    TEST_CHECK(strcmp(loaded.prefix, "abcdef") == 0 && loaded.nibbles == 5);
+    TEST_CHECK(loaded.scanned == 609043 && loaded.found == 609043);
+    // a known match is only kept if nothing smaller is left to scan
+    TEST_CHECK(pow_search_monitored("abcdef", 5, loaded.scanned, loaded.found,
+                                    threads, &mon) == 609043);
+    TEST_CHECK(pow_search_monitored("abcdef", 5, 600000, 700000, threads,
+                                    NULL) == 609043);
+  }
+  remove(path);
+}
+
 void test_day05(void) {
   TEST_CHECK(is_nice("ugknbfddgicrmopn"));
   TEST_CHECK(is_nice("aaa"));
@@ -269,13 +945,133 @@ void test_day05(void) {
   TEST_CHECK(!is_nice2("ieodomkazucvgmuy"));
   TEST_CHECK(!is_nice2("aaa"));
   TEST_CHECK(is_nice2("aaaa"));
+
+  // batch classifier against is_nice, lengths around the 16 byte register
+  static char buf[64 * 1024];
+  uint64_t rng = 3;
+  usize len = 0, expected = 0;
+  for (int i = 0; i < 2000; ++i) {
+    usize line_len = i % 21;
+    usize start = len;
+    for (usize j = 0; j < line_len; ++j) {
+      rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+      buf[len++] = "aeioubcdpqxyz"[(rng >> 33) % 13];
+    }
+    buf[len] = '\0';
+    expected += is_nice(buf + start);
+    buf[len++] = '\n';
+  }
+  TEST_CHECK(d5_count_nice(buf, len) == expected);
+  TEST_MSG("expected %zu", expected);
 }
 
 void test_day06(void) {
   {
-    uint8_t arr[1000 * 1000] = {0};
-    day06_perform_cmd(arr, PART1, "turn on", 0, 0, 999, 999);
-    TEST_CHECK(day06_total(arr) == 1000 * 1000);
+    d6_cmd cmd;
+    TEST_CHECK(day06_parse_line("turn off 499,0 through 500,999", &cmd));
+    TEST_CHECK(cmd.op == CLEAR && cmd.x1 == 499 && cmd.y1 == 0 &&
+               cmd.x2 == 500 && cmd.y2 == 999);
+    TEST_CHECK(day06_parse_line("toggle 1,2 through 3,4", &cmd));
+    TEST_CHECK(cmd.op == FLIP && cmd.y2 == 4);
+    TEST_CHECK(!day06_parse_line("turn on 0,0 through 1000,0", &cmd));
+    TEST_CHECK(!day06_parse_line("turn 0,0 through 1,1", &cmd));
+  }
+  {
+    grid g = day06_grid_create(PART1);
+    day06_perform_cmd(&g, PART1, "turn on", 0, 0, 999, 999);
+    TEST_CHECK(day06_total(&g) == 1000 * 1000);
+    day06_perform_cmd(&g, PART1, "toggle", 0, 0, 999, 0);
+    TEST_CHECK(day06_total(&g) == 1000 * 1000 - 1000);
+    day06_perform_cmd(&g, PART1, "turn off", 499, 499, 500, 500);
+    TEST_CHECK(day06_total(&g) == 1000 * 1000 - 1000 - 4);
+    grid_free(&g);
+  }
+  {
+    grid g = day06_grid_create(PART2);
+    day06_perform_cmd(&g, PART2, "turn on", 0, 0, 0, 0);
+    TEST_CHECK(day06_total(&g) == 1);
+    day06_perform_cmd(&g, PART2, "toggle", 0, 0, 999, 999);
+    TEST_CHECK(day06_total(&g) == 2000001);
+    day06_perform_cmd(&g, PART2, "turn off", 0, 0, 999, 999);
+    day06_perform_cmd(&g, PART2, "turn off", 0, 0, 999, 999);
+    day06_perform_cmd(&g, PART2, "turn off", 0, 0, 999, 999);
+    TEST_CHECK(day06_total(&g) == 0);
+    // no wrapping at 255
+    for (int i = 0; i < 200; ++i) {
+      day06_perform_cmd(&g, PART2, "toggle", 0, 0, 0, 0);
+    }
+    TEST_CHECK(day06_total(&g) == 400);
+    grid_free(&g);
+  }
+  {
+    // compressed engine against the grid, on random commands
+    uint64_t rng = 7;
+    d6_cmd cmds[200];
+    u32 r[4];
+    for (usize i = 0; i < 200; ++i) {
+      for (int k = 0; k < 4; ++k) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        r[k] = rng >> 33;
+      }
+      u32 x1 = r[0] % 1000, y1 = r[1] % 1000;
+      cmds[i] = (d6_cmd){.op = (bs_range_op[]){SET, CLEAR, FLIP}[i % 3],
+                         .x1 = x1,
+                         .y1 = y1,
+                         .x2 = x1 + r[2] % (1000 - x1),
+                         .y2 = y1 + r[3] % (1000 - y1)};
+    }
+    for (solution_part part = PART1; part <= PART2; ++part) {
+      grid g = day06_grid_create(part);
+      for (usize i = 0; i < 200; ++i) {
+        day06_apply(&g, part, cmds[i]);
+      }
+      TEST_CHECK(day06_compressed_total(cmds, 200, part) == day06_total(&g));
+      if (part == PART1) {
+        d6_bitgrid bits = d6_bitgrid_create(D6_GRID_SIZE, D6_GRID_SIZE);
+        for (usize i = 0; i < 200; ++i) {
+          d6_bitgrid_apply(&bits, cmds[i]);
+        }
+        TEST_CHECK(d6_bitgrid_count(&bits) == day06_total(&g));
+        d6_bitgrid_free(&bits);
+      }
+      // the same in bands, whatever their number
+      for (usize threads = 1; threads <= 20; threads += 3) {
+        grid banded = day06_grid_create(part);
+        TEST_CHECK(day06_apply_banded(&banded, part, cmds, 200, threads) ==
+                   day06_total(&g));
+        TEST_MSG("threads %zu", threads);
+        grid_free(&banded);
+      }
+      grid_free(&g);
+    }
+    TEST_CHECK(day06_compressed_total(cmds, 0, PART1) == 0);
+  }
+  {
+    // word boundaries of the bit-packed grid
+    d6_bitgrid bits = d6_bitgrid_create(130, 3);
+    d6_bitgrid_apply(&bits, (d6_cmd){.op = SET, .x1 = 0, .x2 = 129, .y2 = 2});
+    TEST_CHECK(d6_bitgrid_count(&bits) == 390);
+    d6_bitgrid_apply(
+        &bits, (d6_cmd){.op = CLEAR, .x1 = 63, .x2 = 64, .y1 = 1, .y2 = 1});
+    TEST_CHECK(d6_bitgrid_count(&bits) == 388);
+    d6_bitgrid_apply(&bits, (d6_cmd){.op = FLIP, .x1 = 5, .x2 = 5, .y2 = 0});
+    d6_bitgrid_apply(
+        &bits, (d6_cmd){.op = FLIP, .x1 = 64, .x2 = 127, .y1 = 2, .y2 = 2});
+    TEST_CHECK(d6_bitgrid_count(&bits) == 388 - 1 - 64);
+    TEST_CHECK(bits.bits[2 * bits.words + 2] == 3);
+    d6_bitgrid_free(&bits);
+  }
+  {
+    // far bigger than any grid would fit
+    const u32 n = 1000000;
+    d6_cmd cmds[] = {
+        {.op = SET, .x1 = 0, .y1 = 0, .x2 = n - 1, .y2 = n - 1},
+        {.op = FLIP, .x1 = 1, .y1 = 1, .x2 = n - 2, .y2 = n - 2},
+        {.op = CLEAR, .x1 = 0, .y1 = 0, .x2 = 0, .y2 = n - 1},
+    };
+    TEST_CHECK(day06_compressed_total(cmds, 3, PART1) == 3ULL * n - 4);
+    TEST_CHECK(day06_compressed_total(cmds, 3, PART2) ==
+               (u64)n * n + 2ULL * (n - 2) * (n - 2) - n);
   }
 }
 
@@ -298,6 +1094,19 @@ void test_day07(void) {
   TEST_CHECK(d7_eval_var(&m, "x") == 123);
   TEST_CHECK(d7_eval_var(&m, "y") == 456);
   d7_machine_free(&m);
+
+  // round trip through the cached form
+  char text[] = "123 -> x\nx LSHIFT 2 -> f\nNOT x -> h\nf OR h -> a";
+  input_buf in = {.data = text, .len = strlen(text)};
+  void *gates;
+  usize len;
+  TEST_ASSERT(d7_parse_gates(&in, &gates, &len));
+  TEST_CHECK(len == 4 * sizeof(d7_gate));
+  m = d7_machine_create(256);
+  d7_load_gates(&m, gates, len / sizeof(d7_gate));
+  free(gates);
+  TEST_CHECK(d7_eval_var(&m, "a") == (492 | 65412));
+  d7_machine_free(&m);
 }
 
 void test_day08(void) {
@@ -325,6 +1134,41 @@ void test_day08(void) {
     TEST_CHECK(r.code_count == 6);
     TEST_CHECK(r.rep_count == 11);
   }
+
+  // whole-buffer scanner against the line by line one, with runs of
+  // backslashes crossing 64-byte blocks
+  static const char *pieces[] = {"a", "x", "\\\\", "\\\"", "\\x4f", "xx"};
+  static char buf[8192];
+  uint64_t rng = 7;
+  for (int round = 0; round < 100; ++round) {
+    usize len = 0;
+    d8_totals expected = {0};
+    int lines = round % 20 + 1;
+    for (int l = 0; l < lines; ++l) {
+      usize start = len;
+      buf[len++] = '"';
+      int n = round * 3 % 40 + l;
+      for (int k = 0; k < n; ++k) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        const char *piece = pieces[(rng >> 33) % 6];
+        memcpy(buf + len, piece, strlen(piece));
+        len += strlen(piece);
+      }
+      buf[len++] = '"';
+      buf[len] = '\0';
+      d8_result r = d8_process_line(buf + start);
+      expected.code_count += r.code_count;
+      expected.char_count += r.char_count;
+      expected.rep_count += r.rep_count;
+      if (l < lines - 1 || round % 2)
+        buf[len++] = '\n';
+    }
+    d8_totals totals = {0};
+    d8_scan(buf, len, &totals);
+    TEST_CHECK(totals.code_count == expected.code_count);
+    TEST_CHECK(totals.char_count == expected.char_count);
+    TEST_CHECK(totals.rep_count == expected.rep_count);
+  }
 }
 
 void test_day09(void) {
@@ -391,12 +1235,23 @@ void test_day12(void) {
   TEST_CHECK(d12_next_num(&finder, &n));
   TEST_CHECK(n == -145);
   TEST_CHECK(!d12_next_num(&finder, &n));
+  TEST_CHECK(!d12_next_num(&finder, &n));
+  TEST_CHECK(d12_sum_all("[1,{\"a\":-2,\"b\":\"red\"},30]") == 29);
 
   TEST_CHECK(d12_sum_non_red("{}") == 0);
   TEST_CHECK(d12_sum_non_red("{\"a\":[1,2,3]}") == 6);
   TEST_CHECK(d12_sum_non_red("{\"a\":[1,2,3], \"b\":\"red\"}") == 0);
   TEST_CHECK(d12_sum_non_red("{\"a\":[1,2,3], \"b\":-12}") == -6);
   TEST_CHECK(d12_sum_non_red("{\"a\":[1,2,3], \"b\":-12}") == -6);
+  TEST_CHECK(d12_sum_non_red("[1,{\"c\":\"red\",\"b\":2},3]") == 4);
+  TEST_CHECK(d12_sum_non_red("[1,\"red\",5]") == 6);
+  TEST_CHECK(d12_sum_non_red("{\"red\" : 1, \"x\":\"re\\\"d\"}") == 1);
+  TEST_CHECK(d12_sum_non_red("{\"a\":{\"b\":[7],\"c\":\"red\"},\"d\":2}") == 2);
+  TEST_CHECK(d12_sum_non_red("[[[1],[\"red\",{\"e\":{\"f\":\"red\"},\"g\":9}]]]") ==
+             10);
+  // UTF-8 in strings, bytes past 0x7f
+  TEST_CHECK(d12_sum_all("[\"caf\xc3\xa9\",4,\"\xe2\x82\xac\",-1]") == 3);
+  TEST_CHECK(d12_sum_non_red("[\"caf\xc3\xa9\",4,\"\xe2\x82\xac\",-1]") == 3);
 }
 
 void test_day13(void) {
@@ -445,10 +1300,28 @@ TEST_LIST = {
     {"test string hashtable growth", test_string_hashtable_growth},
     {"test bitset", test_bitset},
     {"test bitset ranges", test_bitset_ranges},
+    {"test grid", test_grid},
+    {"test roaring", test_roaring},
+    {"test parsers", test_parsers},
+    {"test splitter", test_splitter},
     {"test strpool", test_strpool},
+    {"test strpool growth", test_strpool_growth},
 
     {"test arena", test_arena},
+    {"test pool", test_pool},
+    {"test newline index", test_newline_index},
+    {"test line iterator", test_line_iter},
+    {"test input source", test_input_source},
+    {"test cache", test_cache},
+    {"test spsc ring", test_spsc_ring},
+    {"test pipeline", test_pipeline},
+    {"test md5 lanes", test_md5_lanes},
+    {"test md5 stream", test_md5_stream},
 
+    {"test day 1", test_day01},
+    {"test day 2", test_day02},
+    {"test day 3", test_day03},
+    {"test day 4", test_day04},
     {"test day 5", test_day05},
     {"test day 6", test_day06},
     {"test day 7", test_day07},